@@ -47,11 +47,24 @@ int main(int argc, char *argv[]) {
 Application::Application(char *infile) {
 	int i;
 	par = new Params();
-	srand (time(NULL));
 	par->setparams(infile);
+	rng.seed(par->SEED, RNG_STREAM_APP);
+	scenario.init(par);
 	log = new Log(par);
+	metrics = new Metrics(par, DUMMYLASTMSGTYPE);
 	en = new EmulNet(par);
 	mp1 = (MP1Node **) malloc(par->EN_GPSZ * sizeof(MP1Node *));
+	workers = new WorkerPool(par->THREADS);
+	batches.resize(workers->size());
+	for( i = 0; i < (int)batches.size(); i++ ) {
+		memset(&batches[i].metrics, 0, sizeof(MetricBatch));
+		memset(&batches[i].blocks, 0, sizeof(PoolCache));
+	}
+	failedAt.resize(par->EN_GPSZ, -1);
+	upAtEnd.resize(par->EN_GPSZ, false);
+	wakes = 0;
+	en->ENwake(&wheel);
+	en->ENmetrics(metrics);
 
 	/*
 	 * Init all nodes
@@ -63,22 +76,27 @@ Application::Application(char *infile) {
 		Address joinaddr;
 		joinaddr = getjoinaddr();
 		addressOfMemberNode = (Address *) en->ENinit(addressOfMemberNode, par->PORTNUM);
-		mp1[i] = new MP1Node(memberNode, par, en, log, addressOfMemberNode);
+		mp1[i] = new MP1Node(memberNode, par, en, log, metrics, addressOfMemberNode);
 		log->LOG(&(mp1[i]->getMemberNode()->addr), "APP");
+		// ENinit hands out ids 1, 2, ... so node i has id i + 1
+		wheel.schedule(i + 1, nextWake(i));
 		delete addressOfMemberNode;
 	}
+	log->LOG(&(mp1[0]->getMemberNode()->addr), "Running with seed %lu", par->SEED);
 }
 
 /**
  * Destructor
  */
 Application::~Application() {
+	delete workers;
 	delete log;
-	delete en;
 	for ( int i = 0; i < par->EN_GPSZ; i++ ) {
 		delete mp1[i];
 	}
 	free(mp1);
+	delete en;
+	delete metrics;
 	delete par;
 }
 
@@ -89,28 +107,38 @@ Application::~Application() {
  */
 int Application::run()
 {
-	cout<< "Running"<<endl;
+	cout<< "Running with seed " << par->SEED <<endl;
 	int i;
 	int timeWhenAllNodesHaveJoined = 0;
 	// boolean indicating if all nodes have joined
 	bool allNodesJoined = false;
-	srand(time(NULL));
 
-	// As time runs along
-	for( par->globaltime = 0; par->globaltime < TOTAL_RUNNING_TIME; ++par->globaltime ) {
+	// As time runs along, from one tick with something to do to the next
+	for( par->globaltime = 0; par->globaltime < par->RUN_TIME; par->globaltime = nextEvent() ) {
 		// Run the membership protocol
 		mp1Run();
 		// Fail some nodes
 		fail();
+		if( metrics->due(par->getcurrtime()) ) {
+			logMetrics();
+		}
 	}
 
-	// Clean up
-	en->ENcleanup();
-
+	// Clean up: note which nodes were up and sample their member lists as
+	// the run left them, then let them leave while the network still takes
+	// their LEAVEs
+	sampleMembers();
 	for(i=0;i<=par->EN_GPSZ-1;i++) {
+		 upAtEnd[i] = !mp1[i]->getMemberNode()->bFailed;
 		 mp1[i]->finishUpThisNode();
 	}
 
+	metrics->snapshot(par->getcurrtime());
+	en->ENcleanup();
+	logProbes();
+	logDetection();
+	logWakes();
+
 	return SUCCESS;
 }
 
@@ -120,23 +148,121 @@ int Application::run()
  * DESCRIPTION:	This function performs all the membership protocol functionalities
  */
 void Application::mp1Run() {
-	int i;
+	unsigned int i;
+
+	// Only the nodes with mail or an expiring timer have anything to do
+	en->ENdeliver();
+	awake.clear();
+	wheel.expire(par->getcurrtime(), awake);
+	for( i = 0; i < awake.size(); i++ ) {
+		awake[i]--;
+	}
+	sort(awake.begin(), awake.end(), greater<int>());
 
-	// For all the nodes in the system
-	for( i = 0; i <= par->EN_GPSZ-1; i++) {
+	// For all the nodes woken up
+	for( i = 0; i < awake.size(); i++ ) {
+		int n = awake[i];
 
 		/*
 		 * Receive messages from the network and queue them in the membership protocol queue
 		 */
-		if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
+		if( par->getcurrtime() > (int)(par->STEP_RATE*n) && !(mp1[n]->getMemberNode()->bFailed) ) {
 			// Receive messages from the network and queue them
-			mp1[i]->recvLoop();
+			mp1[n]->recvLoop();
+			metrics->countQueue(mp1[n]->getMemberNode()->mp1q.size());
+		}
+
+	}
+
+	// Run the nodes on the workers, then apply what they did in node order
+	if( !awake.empty() ) {
+		workers->run([this](int worker) { runNodes(worker); });
+	}
+	for( i = 0; i < batches.size(); i++ ) {
+		log->flushBatch(&batches[i].log);
+		en->ENflush(&batches[i].sends, &batches[i].blocks);
+		metrics->flushBatch(&batches[i].metrics);
+		cout << batches[i].out << flush;
+		batches[i].out.clear();
+		nodeCount += batches[i].joined;
+		batches[i].joined = 0;
+	}
+
+	// Put the nodes that ran back on the wheel for their next timer
+	for( i = 0; i < awake.size(); i++ ) {
+		int wake = nextWake(awake[i]);
+		if( wake >= 0 ) {
+			wheel.schedule(awake[i] + 1, wake);
 		}
+	}
+	wakes += awake.size();
+
+	if( par->globaltime % 500 == 0 && par->getcurrtime() > 0 && !mp1[0]->getMemberNode()->bFailed ) {
+		TRACE(TRACE_DEBUG, log, &mp1[0]->getMemberNode()->addr, "@@time=%d", par->getcurrtime());
+	}
+}
+
+/**
+ * FUNCTION NAME: nextWake
+ *
+ * DESCRIPTION: The next tick node i has to run at: its introduction, or
+ * 				the next timer of its protocol. -1 if it only needs to run
+ * 				when mail comes in.
+ */
+int Application::nextWake(int i) {
+	if( par->getcurrtime() < (int)(par->STEP_RATE*i) ) {
+		return (int)(par->STEP_RATE*i);
+	}
+	return mp1[i]->nextWake();
+}
 
+/**
+ * FUNCTION NAME: nextEvent
+ *
+ * DESCRIPTION: The next tick anything happens at: a node wakes up, a
+ * 				queued message arrives or the scenario acts. Ticks in between
+ * 				would do nothing, so the run jumps over them.
+ */
+int Application::nextEvent() {
+	int now = par->getcurrtime();
+	long next = par->RUN_TIME;
+	long wake = wheel.nextDue();
+	long mail = en->ENnextDelivery();
+	long event = scenario.nextTime();
+
+	if( wake >= 0 ) {
+		next = min(next, wake);
 	}
+	if( mail >= 0 ) {
+		next = min(next, mail);
+	}
+	if( event >= 0 ) {
+		next = min(next, event);
+	}
+	return (int)max(next, (long)now + 1);
+}
 
-	// For all the nodes in the system
-	for( i = par->EN_GPSZ - 1; i >= 0; i-- ) {
+/**
+ * FUNCTION NAME: runNodes
+ *
+ * DESCRIPTION: Run one worker's share of the nodes woken up this tick.
+ * 				Worker w takes the w-th contiguous slice of them in
+ * 				descending order, so reading the batches in worker order
+ * 				gives the same order as running them on one thread.
+ */
+void Application::runNodes(int worker) {
+	int n = awake.size();
+	int first = (long)n * worker / batches.size();
+	int last = (long)n * (worker + 1) / batches.size();
+	TickBatch &batch = batches[worker];
+
+	log->setBatch(&batch.log);
+	en->ENbatch(&batch.sends, &batch.blocks);
+	metrics->setBatch(&batch.metrics);
+
+	// For this worker's nodes
+	for( int p = first; p < last; p++ ) {
+		int i = awake[p];
 
 		/*
 		 * Introduce nodes into the distributed system
@@ -144,8 +270,8 @@ void Application::mp1Run() {
 		if( par->getcurrtime() == (int)(par->STEP_RATE*i) ) {
 			// introduce the ith node into the system at time STEPRATE*i
 			mp1[i]->nodeStart(JOINADDR, par->PORTNUM);
-			cout<<i<<"-th introduced node is assigned with the address: "<<mp1[i]->getMemberNode()->addr.getAddress() << endl;
-			nodeCount += i;
+			batch.out += to_string(i) + "-th introduced node is assigned with the address: " + mp1[i]->getMemberNode()->addr.getAddress() + "\n";
+			batch.joined += i;
 		}
 
 		/*
@@ -154,52 +280,258 @@ void Application::mp1Run() {
 		else if( par->getcurrtime() > (int)(par->STEP_RATE*i) && !(mp1[i]->getMemberNode()->bFailed) ) {
 			// handle messages and send heartbeats
 			mp1[i]->nodeLoop();
-			#ifdef DEBUGLOG
-			if( (i == 0) && (par->globaltime % 500 == 0) ) {
-				log->LOG(&mp1[i]->getMemberNode()->addr, "@@time=%d", par->getcurrtime());
+		}
+
+	}
+
+	log->setBatch(NULL);
+	en->ENbatch(NULL, NULL);
+	metrics->setBatch(NULL);
+}
+
+/**
+ * FUNCTION NAME: logProbes
+ *
+ * DESCRIPTION: Append the cost of failure detection to msgcount.log: the
+ * 				probes the nodes started, the messages and bytes each
+ * 				indirect probe took, and how many messages shared a frame.
+ * 				Message bytes leave out the piggyback, which is sent once
+ * 				per frame.
+ */
+void Application::logProbes() {
+	long probes = 0, indirect = 0, probers = 0, msgs = 0, bytes = 0, framed = 0, frames = 0;
+	FILE *file = fopen("msgcount.log", "a");
+
+	for( int i = 0; i < par->EN_GPSZ; i++ ) {
+		probes += mp1[i]->getProbes();
+		indirect += mp1[i]->getIndirectProbes();
+		probers += mp1[i]->getIndirectProbers();
+		frames += mp1[i]->getFramesSent();
+		// every message a node sends after joining goes into a frame
+		for( int type = PING; type <= LEAVE; type++ ) {
+			if ( type == FRAME ) {
+				continue;
+			}
+			en_typecount count = mp1[i]->getSentType(type);
+			framed += count.msgs;
+			if ( type >= SUBPING && type <= SUBPINGACK ) {
+				msgs += count.msgs;
+				bytes += count.bytes;
 			}
-			#endif
 		}
+	}
 
+	fprintf(file, "probes direct %ld indirect %ld probers %ld\n", probes, indirect, probers);
+	if ( frames > 0 ) {
+		fprintf(file, "frames %ld messages %ld per frame %.2f\n", frames, framed, (double)framed / frames);
+	}
+	if ( indirect > 0 ) {
+		fprintf(file, "per indirect probe: probers %.2f msgs %.2f bytes %.1f\n",
+				(double)probers / indirect, (double)msgs / indirect, (double)bytes / indirect);
 	}
+	fclose(file);
+}
+
+/**
+ * FUNCTION NAME: logDetection
+ *
+ * DESCRIPTION: Append a histogram of failure detection latency to
+ * 				msgcount.log: for every node still failed at the end of
+ * 				the run and every live node that was in the group when
+ * 				it failed and up at the end of the run, before the nodes
+ * 				left, the ticks from the latest failure to that observer
+ * 				first logging its removal. An observer that dropped the
+ * 				node before it failed and never took it back is counted
+ * 				as early, not as a detection. Buckets are powers of two.
+ */
+void Application::logDetection() {
+	vector<long> buckets;
+	long observed = 0, undetected = 0, early = 0, sum = 0;
+	int worst = 0;
+	FILE *file = fopen("msgcount.log", "a");
+
+	for( int f = 0; f < par->EN_GPSZ; f++ ) {
+		//a node that came back has no open incident to measure
+		if ( failedAt[f] < 0 || upAtEnd[f] ) {
+			continue;
+		}
+		int id = *(int *)(mp1[f]->getMemberNode()->addr.addr);
+		for( int o = 0; o < par->EN_GPSZ; o++ ) {
+			if ( o == f || !upAtEnd[o] || (int)(par->STEP_RATE*o) >= failedAt[f] ) {
+				continue;
+			}
+			int removed = mp1[o]->getRemovedAt(id);
+			if ( removed < 0 ) {
+				undetected++;
+				continue;
+			}
+			if ( removed < failedAt[f] ) {
+				early++;
+				continue;
+			}
+			int latency = removed - failedAt[f];
+			unsigned int bucket = 0;
+			while ( (1 << bucket) <= latency ) {
+				bucket++;
+			}
+			if ( bucket >= buckets.size() ) {
+				buckets.resize(bucket + 1, 0);
+			}
+			buckets[bucket]++;
+			observed++;
+			sum += latency;
+			worst = max(worst, latency);
+		}
+	}
+
+	fprintf(file, "detection observers %ld undetected %ld early %ld mean %.1f max %d bound %d\n",
+			observed, undetected, early, observed ? (double)sum / observed : 0.0, worst, (2 * par->EN_GPSZ - 1) * TREMOVE);
+	for( unsigned int i = 0; i < buckets.size(); i++ ) {
+		fprintf(file, "detection %4d-%-4d %6ld\n", i ? 1 << (i - 1) : 0, i ? (1 << i) - 1 : 0, buckets[i]);
+	}
+	fclose(file);
+}
+
+/**
+ * FUNCTION NAME: logMetrics
+ *
+ * DESCRIPTION: Write a row of metrics.csv: what was counted since the last
+ * 				one, and the member list size of every node in the group
+ */
+void Application::logMetrics() {
+	sampleMembers();
+	metrics->snapshot(par->getcurrtime());
+}
+
+/**
+ * FUNCTION NAME: sampleMembers
+ *
+ * DESCRIPTION: Gauge the member list size of every node in the group for
+ * 				the next row of metrics.csv
+ */
+void Application::sampleMembers() {
+	for( int i = 0; i < par->EN_GPSZ; i++ ) {
+		Member *node = mp1[i]->getMemberNode();
+		if ( node->inited && node->inGroup && !node->bFailed ) {
+			metrics->sampleMembers(node->liveSet.size() + 1);
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: logWakes
+ *
+ * DESCRIPTION: Append to msgcount.log how many node runs the timing wheel
+ * 				asked for, out of one per node per tick
+ */
+void Application::logWakes() {
+	FILE *file = fopen("msgcount.log", "a");
+
+	fprintf(file, "node runs %ld of %ld node-ticks\n", wakes, (long)par->EN_GPSZ * par->getcurrtime());
+	fclose(file);
 }
 
 /**
  * FUNCTION NAME: fail
  *
- * DESCRIPTION: This function controls the failure of nodes
+ * DESCRIPTION: Apply the scenario events due this tick: fail, leave or
+ * 				restart nodes, and open or close the message drop window
  *
  * Note: this is used only by MP1
  */
 void Application::fail() {
-	int i, removed;
-
-	// fail half the members at time t=400
-	if( par->DROP_MSG && par->getcurrtime() == 50 ) {
-		par->dropmsg = 1;
-	}
-
-	if( par->SINGLE_FAILURE && par->getcurrtime() == 100 ) {
-		removed = (rand() % par->EN_GPSZ);
-		#ifdef DEBUGLOG
-		log->LOG(&mp1[removed]->getMemberNode()->addr, "Node failed at time=%d", par->getcurrtime());
-		#endif
-		mp1[removed]->getMemberNode()->bFailed = true;
-	}
-	else if( par->getcurrtime() == 100 ) {
-		removed = rand() % par->EN_GPSZ/2;
-		for ( i = removed; i < removed + par->EN_GPSZ/2; i++ ) {
-			#ifdef DEBUGLOG
-			log->LOG(&mp1[i]->getMemberNode()->addr, "Node failed at time = %d", par->getcurrtime());
-			#endif
-			mp1[i]->getMemberNode()->bFailed = true;
+	int i, first;
+
+	while( scenario.due(par->getcurrtime()) ) {
+		ScenarioEvent event = scenario.pop();
+
+		switch( event.action ) {
+		case SCENARIO_FAIL:
+			failNode(event.node - 1);
+			break;
+		case SCENARIO_FAIL_RANDOM:
+			// event.node consecutive members from a random one
+			first = rng.nextInt(par->EN_GPSZ - event.node + 1);
+			for ( i = first; i < first + event.node; i++ ) {
+				failNode(i);
+			}
+			break;
+		case SCENARIO_LEAVE:
+			leaveNode(event.node - 1);
+			break;
+		case SCENARIO_RESTART:
+			restartNode(event.node - 1);
+			break;
+		case SCENARIO_DROP_START:
+			par->MSG_DROP_PROB = event.prob;
+			par->dropmsg = 1;
+			break;
+		case SCENARIO_DROP_END:
+			par->dropmsg = 0;
+			break;
 		}
 	}
+}
 
-	if( par->DROP_MSG && par->getcurrtime() == 300) {
-		par->dropmsg=0;
+/**
+ * FUNCTION NAME: failNode
+ *
+ * DESCRIPTION: Fail node i, if it has started and is up. Detection latency
+ * 				is measured from its latest failure.
+ */
+void Application::failNode(int i) {
+	Member *node = mp1[i]->getMemberNode();
+
+	if( !node->inited || node->bFailed ) {
+		return;
 	}
+	log->logEvent(EVENT_FAIL, &node->addr, &node->addr);
+	node->bFailed = true;
+	failedAt[i] = par->getcurrtime();
+}
 
+/**
+ * FUNCTION NAME: leaveNode
+ *
+ * DESCRIPTION: Make node i leave the group gracefully, if it is up
+ */
+void Application::leaveNode(int i) {
+	Member *node = mp1[i]->getMemberNode();
+
+	if( !node->inited || node->bFailed ) {
+		return;
+	}
+	log->logEvent(EVENT_LEAVE, &node->addr, &node->addr);
+	mp1[i]->finishUpThisNode();
+}
+
+/**
+ * FUNCTION NAME: restartNode
+ *
+ * DESCRIPTION: Restart node i if it failed or left. It rejoins through the
+ * 				introducer, or the first live node if the introducer is
+ * 				down, or starts the group over if no node is live.
+ */
+void Application::restartNode(int i) {
+	Member *node = mp1[i]->getMemberNode();
+	Address joinaddr = node->addr;
+	int wake;
+
+	if( !node->bFailed ) {
+		return;
+	}
+	for( int j = 0; j < par->EN_GPSZ; j++ ) {
+		if( j != i && mp1[j]->getMemberNode()->inited && !mp1[j]->getMemberNode()->bFailed ) {
+			joinaddr = mp1[j]->getMemberNode()->addr;
+			break;
+		}
+	}
+	log->logEvent(EVENT_RESTART, &node->addr, &node->addr);
+	mp1[i]->nodeRestart(&joinaddr);
+	wake = nextWake(i);
+	if( wake >= 0 ) {
+		wheel.schedule(i + 1, wake);
+	}
 }
 
 /**
@@ -14,6 +14,11 @@
 #include "Member.h"
 #include "EmulNet.h"
 #include "Queue.h"
+#include "WorkerPool.h"
+#include "Random.h"
+#include "TimerWheel.h"
+#include "Scenario.h"
+#include "Metrics.h"
 
 /**
  * global variables
@@ -24,7 +29,21 @@ int nodeCount = 0;
  * Macros
  */
 #define ARGS_COUNT 2
-#define TOTAL_RUNNING_TIME 700
+
+/**
+ * STRUCT NAME: TickBatch
+ *
+ * DESCRIPTION: Output of one worker's nodes during a tick, kept back until
+ * 				the barrier so that it can be applied in node order
+ */
+typedef struct TickBatch {
+	LogBatch log;
+	en_batch sends;
+	PoolCache blocks;
+	MetricBatch metrics;
+	string out;
+	int joined;
+}TickBatch;
 
 /**
  * CLASS NAME: Application
@@ -38,8 +57,36 @@ private:
 	char JOINADDR[30];
 	EmulNet *en;
     Log *log;
+	Metrics *metrics;
 	MP1Node **mp1;
 	Params *par;
+	// which nodes fail
+	Random rng;
+	// failures, restarts and drop windows still to come
+	Scenario scenario;
+	WorkerPool *workers;
+	vector<TickBatch> batches;
+	// time each node was failed, or -1
+	vector<int> failedAt;
+	// whether each node was up when the run ended, before it left
+	vector<bool> upAtEnd;
+	// wakes nodes, keyed by node id, when a timer expires or mail arrives
+	TimerWheel wheel;
+	// indices of the nodes running this tick, highest first
+	vector<int> awake;
+	// node runs so far
+	long wakes;
+	void runNodes(int worker);
+	void failNode(int i);
+	void leaveNode(int i);
+	void restartNode(int i);
+	int nextWake(int i);
+	int nextEvent();
+	void logProbes();
+	void logWakes();
+	void logDetection();
+	void logMetrics();
+	void sampleMembers();
 public:
 	Application(char *);
 	virtual ~Application();
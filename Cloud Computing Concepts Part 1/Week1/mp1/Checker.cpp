@@ -0,0 +1,435 @@
+/**********************************
+ * FILE NAME: Checker.cpp
+ *
+ * DESCRIPTION: Checks a run from its dbg.log, or from its events.bin when
+ * 				it was run with EVENT_LOG set, in one pass over the file.
+ * 				Reports join completeness, failure completeness, accuracy,
+ * 				detection latency and false positives as JSON, and with -s
+ * 				scores the run the way Grader.sh does.
+ *
+ * 				Usage: ./Checker [-s single|multi|msgdrop] [-j summary.json] log
+ **********************************/
+
+#include "stdincludes.h"
+#include "EventLog.h"
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * Macros
+ */
+// longest dbg.log line read whole, as the buffer of Log::LOG
+#define CHECK_LINE_SIZE 30000
+
+/**
+ * STRUCT NAME: Incident
+ *
+ * DESCRIPTION: A node going down, by failure or leave, and the live nodes
+ * 				that removed it before it came back
+ */
+typedef struct Incident {
+	int node;
+	int time;
+	int type;
+	unordered_set<int> detectors;
+	int firstDetection;
+}Incident;
+
+/**
+ * CLASS NAME: Checker
+ *
+ * DESCRIPTION: Folds the events of a run, in log order, into the counts the
+ * 				checks need. Nodes are numbered in the order they are first
+ * 				seen. A removal is a detection when its subject is down
+ * 				and a false positive otherwise.
+ */
+class Checker {
+private:
+	unordered_map<uint64_t, int> index;
+	vector<uint64_t> addrs;
+	// per node, the open incident or -1 while it is up
+	vector<int> down;
+	vector<bool> everDown;
+	vector<Incident> incidents;
+	// distinct observer and subject pairs, and the other nodes each observer saw join
+	unordered_set<uint64_t> joins;
+	vector<int> joinedOthers;
+	// distinct removal lines as Grader.sh counts them, and those naming each node
+	set<pair<uint64_t, int> > removals;
+	vector<int> removalsNaming;
+	// failed nodes in the order Grader.sh takes them
+	vector<int> failed;
+	vector<int> latencies;
+	int falsePositives;
+	int nodeOf(const char *addr);
+	string name(int node);
+	double percentile(double p);
+public:
+	Checker(): falsePositives(0) {}
+	void observe(const EventRecord *event);
+	bool readEvents(const char *data, size_t size);
+	void readLog(FILE *log);
+	void summary(FILE *out);
+	int grade(const char *scenario);
+};
+
+/**
+ * FUNCTION NAME: nodeOf
+ *
+ * DESCRIPTION: The number of a 6-byte address, given one when first seen
+ */
+int Checker::nodeOf(const char *addr) {
+	uint64_t key = 0;
+	memcpy(&key, addr, 6);
+
+	unordered_map<uint64_t, int>::iterator it = index.find(key);
+	if ( it != index.end() ) {
+		return it->second;
+	}
+	int node = addrs.size();
+	index[key] = node;
+	addrs.push_back(key);
+	down.push_back(-1);
+	everDown.push_back(false);
+	joinedOthers.push_back(0);
+	removalsNaming.push_back(0);
+	return node;
+}
+
+/**
+ * FUNCTION NAME: name
+ *
+ * DESCRIPTION: A node's address as dbg.log writes it
+ */
+string Checker::name(int node) {
+	char addr[6];
+	char buf[32];
+
+	memcpy(addr, &addrs[node], 6);
+	snprintf(buf, sizeof(buf), "%d.%d.%d.%d:%d", addr[0], addr[1], addr[2], addr[3], *(short *)&addr[4]);
+	return buf;
+}
+
+/**
+ * FUNCTION NAME: observe
+ *
+ * DESCRIPTION: Count one event
+ */
+void Checker::observe(const EventRecord *event) {
+	char addr[6];
+	int observer, subject;
+
+	EventLog::address(event->observer, addr);
+	observer = nodeOf(addr);
+	EventLog::address(event->subject, addr);
+	subject = nodeOf(addr);
+
+	switch ( event->type ) {
+	case EVENT_JOIN:
+		if ( joins.insert((uint64_t)observer << 32 | subject).second && observer != subject ) {
+			joinedOthers[observer]++;
+		}
+		break;
+	case EVENT_REMOVE:
+		if ( removals.insert(make_pair((uint64_t)observer << 32 | subject, event->time)).second ) {
+			removalsNaming[subject]++;
+			if ( observer != subject ) {
+				removalsNaming[observer]++;
+			}
+		}
+		if ( down[subject] < 0 ) {
+			falsePositives++;
+		}
+		else {
+			Incident &incident = incidents[down[subject]];
+			if ( incident.detectors.insert(observer).second ) {
+				latencies.push_back(event->time - incident.time);
+				if ( incident.firstDetection < 0 ) {
+					incident.firstDetection = event->time;
+				}
+			}
+		}
+		break;
+	case EVENT_FAIL:
+	case EVENT_LEAVE:
+		if ( down[subject] < 0 ) {
+			Incident incident;
+			incident.node = subject;
+			incident.time = event->time;
+			incident.type = event->type;
+			incident.firstDetection = -1;
+			down[subject] = incidents.size();
+			incidents.push_back(incident);
+		}
+		if ( event->type == EVENT_FAIL && !everDown[subject] ) {
+			failed.push_back(subject);
+		}
+		everDown[subject] = true;
+		break;
+	case EVENT_RESTART:
+		down[subject] = -1;
+		break;
+	}
+}
+
+/**
+ * FUNCTION NAME: readEvents
+ *
+ * DESCRIPTION: Count the records of a mapped events.bin
+ *
+ * RETURNS:
+ * false if the header is not that of this version
+ */
+bool Checker::readEvents(const char *data, size_t size) {
+	const EventFileHeader *header = (const EventFileHeader *)data;
+	const EventRecord *events = (const EventRecord *)(data + sizeof(EventFileHeader));
+
+	if ( header->version != EVENT_VERSION || header->recordSize != sizeof(EventRecord) ) {
+		return false;
+	}
+	size_t count = (size - sizeof(EventFileHeader)) / sizeof(EventRecord);
+	for ( size_t i = 0; i < count; i++ ) {
+		observe(&events[i]);
+	}
+	return true;
+}
+
+/**
+ * FUNCTION NAME: readLog
+ *
+ * DESCRIPTION: Count the event lines of a dbg.log, parsing them back into
+ * 				records. Other lines are skipped after looking at their
+ * 				first words.
+ */
+void Checker::readLog(FILE *log) {
+	static char line[CHECK_LINE_SIZE];
+	char observer[6], subject[6];
+	int a, b, c, d, port, time, at, used;
+
+	while ( fgets(line, sizeof(line), log) ) {
+		used = 0;
+		if ( sscanf(line, " %d.%d.%d.%d:%d [%d] Node %n", &a, &b, &c, &d, &port, &time, &used) < 6 || used == 0 ) {
+			continue;
+		}
+		observer[0] = a; observer[1] = b; observer[2] = c; observer[3] = d;
+		*(short *)&observer[4] = (short)port;
+		char *rest = line + used;
+		int type = -1;
+
+		if ( sscanf(rest, "failed at time=%d", &at) == 1 ) {
+			type = EVENT_FAIL;
+		}
+		else if ( sscanf(rest, "left at time=%d", &at) == 1 ) {
+			type = EVENT_LEAVE;
+		}
+		else if ( sscanf(rest, "restarted at time=%d", &at) == 1 ) {
+			type = EVENT_RESTART;
+		}
+		if ( type >= 0 ) {
+			EventRecord event = EventLog::make(type, observer, observer, at);
+			observe(&event);
+			continue;
+		}
+
+		char verb[8];
+		if ( sscanf(rest, "%d.%d.%d.%d:%d %7s at time %d", &a, &b, &c, &d, &port, verb, &at) < 7 ) {
+			continue;
+		}
+		if ( strcmp(verb, "joined") == 0 ) {
+			type = EVENT_JOIN;
+		}
+		else if ( strcmp(verb, "removed") == 0 ) {
+			type = EVENT_REMOVE;
+		}
+		else {
+			continue;
+		}
+		subject[0] = a; subject[1] = b; subject[2] = c; subject[3] = d;
+		*(short *)&subject[4] = (short)port;
+		EventRecord event = EventLog::make(type, observer, subject, at);
+		observe(&event);
+	}
+}
+
+/**
+ * FUNCTION NAME: percentile
+ *
+ * DESCRIPTION: Nearest-rank percentile of the sorted detection latencies
+ */
+double Checker::percentile(double p) {
+	if ( latencies.empty() ) {
+		return 0;
+	}
+	size_t rank = (size_t)ceil(p / 100 * latencies.size());
+	return latencies[rank > 0 ? rank - 1 : 0];
+}
+
+/**
+ * FUNCTION NAME: summary
+ *
+ * DESCRIPTION: Write the results as one JSON object. A node is expected to
+ * 				detect an incident when it never went down itself.
+ */
+void Checker::summary(FILE *out) {
+	int nodes = addrs.size();
+	int stayedUp = 0;
+	int completeObservers = 0;
+	long expected = 0, detected = 0;
+
+	for ( int i = 0; i < nodes; i++ ) {
+		stayedUp += everDown[i] ? 0 : 1;
+		completeObservers += joinedOthers[i] == nodes - 1 ? 1 : 0;
+	}
+	sort(latencies.begin(), latencies.end());
+
+	fprintf(out, "{\n");
+	fprintf(out, "  \"nodes\": %d,\n", nodes);
+	fprintf(out, "  \"join\": {\"pairs\": %zu, \"complete_observers\": %d, \"completeness\": %.4f},\n", joins.size(), completeObservers, nodes ? (double)completeObservers / nodes : 0);
+	fprintf(out, "  \"incidents\": [");
+	for ( unsigned int i = 0; i < incidents.size(); i++ ) {
+		Incident &incident = incidents[i];
+		int found = 0;
+		for ( unordered_set<int>::iterator it = incident.detectors.begin(); it != incident.detectors.end(); ++it ) {
+			found += everDown[*it] ? 0 : 1;
+		}
+		expected += stayedUp;
+		detected += found;
+		fprintf(out, "%s\n    {\"node\": \"%s\", \"type\": \"%s\", \"time\": %d, \"detected_by\": %d, \"expected\": %d, \"first_detection\": %d}", i ? "," : "", name(incident.node).c_str(), incident.type == EVENT_FAIL ? "fail" : "leave", incident.time, found, stayedUp, incident.firstDetection);
+	}
+	fprintf(out, "%s],\n", incidents.empty() ? "" : "\n  ");
+	fprintf(out, "  \"failure_completeness\": %.4f,\n", expected ? (double)detected / expected : 1);
+	fprintf(out, "  \"false_positives\": %d,\n", falsePositives);
+	fprintf(out, "  \"accuracy\": %.4f,\n", removals.empty() ? 1 : 1 - (double)falsePositives / removals.size());
+	fprintf(out, "  \"detection_latency\": {\"count\": %zu, \"p50\": %g, \"p90\": %g, \"p99\": %g, \"max\": %g}\n", latencies.size(), percentile(50), percentile(90), percentile(99), percentile(100));
+	fprintf(out, "}\n");
+}
+
+/**
+ * FUNCTION NAME: grade
+ *
+ * DESCRIPTION: Print the checks of a Grader.sh scenario, with the same
+ * 				counts and thresholds
+ *
+ * RETURNS:
+ * the points, or FAILURE for an unknown scenario
+ */
+int Checker::grade(const char *scenario) {
+	bool single = strcmp(scenario, "single") == 0;
+	bool multi = strcmp(scenario, "multi") == 0;
+	bool msgdrop = strcmp(scenario, "msgdrop") == 0;
+	int points = 0, weight = msgdrop ? 15 : 10;
+	int nodes = addrs.size();
+
+	if ( !single && !multi && !msgdrop ) {
+		return FAILURE;
+	}
+
+	// every pair joined, or each of ten observers saw the nine others
+	int complete = 0;
+	for ( int i = 0; i < nodes; i++ ) {
+		complete += joinedOthers[i] == 9 ? 1 : 0;
+	}
+	bool joined = joins.size() == 100 || complete == 10;
+	points += joined ? weight : 0;
+	printf("Checking Join..................%d/%d\n", joined ? weight : 0, weight);
+
+	if ( multi ) {
+		int completeness = 0, accuracy = 0;
+		for ( unsigned int i = 0; i < failed.size() && i < 6; i++ ) {
+			completeness += removalsNaming[failed[i]] >= 5 ? 2 : 0;
+		}
+		for ( unsigned int i = 0; i < failed.size() && accuracy <= 9; i++ ) {
+			accuracy += (int)removals.size() - removalsNaming[failed[i]] == 20 ? 2 : 0;
+		}
+		printf("Checking Completeness..........%d/10\n", completeness);
+		printf("Checking Accuracy..............%d/10\n", accuracy);
+		return points + completeness + accuracy;
+	}
+
+	int failcount = failed.empty() ? 0 : removalsNaming[failed[0]];
+	bool completeness = failcount >= 9;
+	points += completeness ? weight : 0;
+	printf("Checking Completeness..........%d/%d\n", completeness ? weight : 0, weight);
+	if ( single ) {
+		bool accuracy = failcount > 0 && (int)removals.size() - failcount == 0;
+		points += accuracy ? weight : 0;
+		printf("Checking Accuracy..............%d/%d\n", accuracy ? weight : 0, weight);
+	}
+	return points;
+}
+
+/**
+ * FUNCTION NAME: main
+ *
+ * DESCRIPTION: Read the log named last, events.bin if it starts with the
+ * 				event file magic and dbg.log text otherwise, then report
+ */
+int main(int argc, char *argv[]) {
+	const char *scenario = NULL;
+	const char *json = NULL;
+	const char *path = NULL;
+	Checker checker;
+	char magic[8] = {0};
+	FILE *log;
+
+	for ( int i = 1; i < argc; i++ ) {
+		if ( strcmp(argv[i], "-s") == 0 && i + 1 < argc ) {
+			scenario = argv[++i];
+		}
+		else if ( strcmp(argv[i], "-j") == 0 && i + 1 < argc ) {
+			json = argv[++i];
+		}
+		else {
+			path = argv[i];
+		}
+	}
+	if ( path == NULL ) {
+		fprintf(stderr, "Usage: %s [-s single|multi|msgdrop] [-j summary.json] log\n", argv[0]);
+		return FAILURE;
+	}
+
+	if ( (log = fopen(path, "r")) == NULL ) {
+		perror(path);
+		return FAILURE;
+	}
+	if ( fread(magic, 1, sizeof(magic), log) == sizeof(magic) && memcmp(magic, EVENT_MAGIC, sizeof(EVENT_MAGIC)) == 0 ) {
+		struct stat info;
+		fstat(fileno(log), &info);
+		const char *data = (const char *)mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fileno(log), 0);
+		if ( data == MAP_FAILED || (size_t)info.st_size < sizeof(EventFileHeader) || !checker.readEvents(data, info.st_size) ) {
+			fprintf(stderr, "%s: not a version %d event file\n", path, EVENT_VERSION);
+			return FAILURE;
+		}
+		munmap((void *)data, info.st_size);
+	}
+	else {
+		rewind(log);
+		checker.readLog(log);
+	}
+	fclose(log);
+
+	if ( scenario ) {
+		int points = checker.grade(scenario);
+		if ( points < 0 ) {
+			fprintf(stderr, "Unknown scenario %s\n", scenario);
+			return FAILURE;
+		}
+		printf("Score %d\n", points);
+	}
+	if ( json ) {
+		FILE *out = fopen(json, "w");
+		if ( out == NULL ) {
+			perror(json);
+			return FAILURE;
+		}
+		checker.summary(out);
+		fclose(out);
+	}
+	else if ( !scenario ) {
+		checker.summary(stdout);
+	}
+	return SUCCESS;
+}
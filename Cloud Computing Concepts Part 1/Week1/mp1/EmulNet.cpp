@@ -6,23 +6,24 @@
 
 #include "EmulNet.h"
 
+thread_local en_batch *EmulNet::outbox = NULL;
+
 /**
  * Constructor
  */
 EmulNet::EmulNet(Params *p)
 {
 	//trace.funcEntry("EmulNet::EmulNet");
-	int i,j;
 	par = p;
+	rng.seed(par->SEED, RNG_STREAM_NET);
+	linkRng.seed(par->SEED, RNG_STREAM_LINK);
+	faults.init(par);
+	stats.setWidth(max(1, (par->RUN_TIME + EN_STATS_COLUMNS - 1) / EN_STATS_COLUMNS));
+	wheel = NULL;
+	metrics = NULL;
 	emulnet.setNextId(1);
 	emulnet.settCurrBuffSize(0);
 	enInited=0;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			sent_msgs[i][j] = 0;
-			recv_msgs[i][j] = 0;
-		}
-	}
 	//trace.funcExit("EmulNet::EmulNet", SUCCESS);
 }
 
@@ -30,15 +31,15 @@ EmulNet::EmulNet(Params *p)
  * Copy constructor
  */
 EmulNet::EmulNet(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->rng = anotherEmulNet.rng;
+	this->wheel = anotherEmulNet.wheel;
+	this->metrics = anotherEmulNet.metrics;
+	this->links = anotherEmulNet.links;
+	this->linkRng = anotherEmulNet.linkRng;
+	this->faults = anotherEmulNet.faults;
+	this->stats = anotherEmulNet.stats;
 	this->emulnet = anotherEmulNet.emulnet;
 }
 
@@ -46,15 +47,15 @@ EmulNet::EmulNet(EmulNet &anotherEmulNet) {
  * Assignment operator overloading
  */
 EmulNet& EmulNet::operator =(EmulNet &anotherEmulNet) {
-	int i, j;
 	this->par = anotherEmulNet.par;
 	this->enInited = anotherEmulNet.enInited;
-	for ( i = 0; i < MAX_NODES; i++ ) {
-		for ( j = 0; j < MAX_TIME; j++ ) {
-			this->sent_msgs[i][j] = anotherEmulNet.sent_msgs[i][j];
-			this->recv_msgs[i][j] = anotherEmulNet.recv_msgs[i][j];
-		}
-	}
+	this->rng = anotherEmulNet.rng;
+	this->wheel = anotherEmulNet.wheel;
+	this->metrics = anotherEmulNet.metrics;
+	this->links = anotherEmulNet.links;
+	this->linkRng = anotherEmulNet.linkRng;
+	this->faults = anotherEmulNet.faults;
+	this->stats = anotherEmulNet.stats;
 	this->emulnet = anotherEmulNet.emulnet;
 	return *this;
 }
@@ -73,48 +74,218 @@ void *EmulNet::ENinit(Address *myaddr, short port) {
 	// Initialize data structures for this member
 	*(int *)(myaddr->addr) = emulnet.nextid++;
     *(short *)(&myaddr->addr[4]) = 0;
+	enInited = 1;
 	return myaddr;
 }
 
 /**
  * FUNCTION NAME: ENsend
  *
- * DESCRIPTION: EmulNet send function
+ * DESCRIPTION: EmulNet send function. A thread with a batch set only
+ * 				queues the message in it; drops are decided when the batch
+ * 				is flushed. Messages sent after ENcleanup are dropped.
  *
  * RETURNS:
  * size
  */
 int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
 	en_msg *em;
-	static char temp[2048];
-	int sendmsg = rand() % 100;
 
-	if( (emulnet.currbuffsize >= ENBUFFSIZE) || (size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE) || (par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100)) ) {
+	if ( !enInited || size + (int)sizeof(en_msg) >= par->MAX_MSG_SIZE ) {
 		return 0;
 	}
 
-	em = (en_msg *)malloc(sizeof(en_msg) + size);
+	em = (en_msg *)pool.get(sizeof(en_msg) + size);
 	em->size = size;
 
 	memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
 	memcpy(&(em->to.addr), &(toaddr->addr), sizeof(em->from.addr));
 	memcpy(em + 1, data, size);
 
+	if ( metrics && size >= (int)sizeof(int) ) {
+		metrics->countSent(*(int *)data, size);
+	}
+
+	if ( outbox ) {
+		outbox->push_back(em);
+		return size;
+	}
+	return post(em);
+}
+
+/**
+ * FUNCTION NAME: post
+ *
+ * DESCRIPTION: Put a message built by ENsend into the network, or drop it
+ * 				with the global drop rate or the link faults.
+ * 				It goes to the mailbox now if its link takes one tick, and
+ * 				into the event queue otherwise.
+ *
+ * RETURNS:
+ * size, or 0 if the message was dropped
+ */
+int EmulNet::post(en_msg *em) {
+	int sendmsg = rng.nextInt(100);
+	int latency;
+
+	if( par->dropmsg && sendmsg < (int) (par->MSG_DROP_PROB * 100) ) {
+		MsgPool::release(em);
+		return 0;
+	}
+	if ( faults.drop(*(int *)(em->from.addr), *(int *)(em->to.addr), par->getcurrtime()) != LINK_DELIVER ) {
+		MsgPool::release(em);
+		return 0;
+	}
+
+	latency = linkLatency(&em->from, &em->to);
+	if ( latency > 1 ) {
+		inflight.push(par->getcurrtime() + latency, em);
+	}
+	else if ( !deliver(em, par->getcurrtime() + 1) ) {
+		return 0;
+	}
+
+	stats.countSent(*(int *)(em->from.addr), par->getcurrtime());
+	if ( em->size >= (int)sizeof(int) ) {
+		stats.countType(*(int *)(em + 1), em->size);
+	}
+
+	return em->size;
+}
+
+/**
+ * FUNCTION NAME: deliver
+ *
+ * DESCRIPTION: Put a message in its receiver's mailbox, and wake the
+ * 				receiver at tick wake to read it. Drops it if the network
+ * 				buffer is full.
+ */
+bool EmulNet::deliver(en_msg *em, int wake) {
+	if ( emulnet.currbuffsize >= ENBUFFSIZE ) {
+		MsgPool::release(em);
+		return false;
+	}
+
+	vector<int> &box = getMailbox(&em->to);
+	emulnet.mslot[emulnet.currbuffsize] = box.size();
+	box.push_back(emulnet.currbuffsize);
 	emulnet.buff[emulnet.currbuffsize++] = em;
 
-	int src = *(int *)(myaddr->addr);
-	int time = par->getcurrtime();
+	if ( wheel && &box != &emulnet.mailbox[0] ) {
+		wheel->schedule(*(int *)(em->to.addr), wake);
+	}
+	return true;
+}
 
-	assert(src <= MAX_NODES);
-	assert(time < MAX_TIME);
+/**
+ * FUNCTION NAME: linkLatency
+ *
+ * DESCRIPTION: Ticks a message takes from from to to, at least 1. Drawn
+ * 				the first time the link is used and kept for the run.
+ */
+int EmulNet::linkLatency(Address *from, Address *to) {
+	long link = ((long)*(int *)(from->addr) << 32) | (unsigned int)*(int *)(to->addr);
+	map<long, int>::iterator it;
+	double latency;
 
-	sent_msgs[src][time]++;
+	if ( par->LATENCY == LATENCY_NEXT_TICK ) {
+		return 1;
+	}
+	it = links.find(link);
+	if ( it != links.end() ) {
+		return it->second;
+	}
 
-	#ifdef DEBUGLOG
-		sprintf(temp, "Sending 4+%d B msg type %d to %d.%d.%d.%d:%d ", size-4, *(int *)data, toaddr->addr[0], toaddr->addr[1], toaddr->addr[2], toaddr->addr[3], *(short *)&toaddr->addr[4]);
-	#endif
+	switch ( par->LATENCY ) {
+	case LATENCY_UNIFORM:
+		latency = par->LATENCY_MEAN + par->LATENCY_SPREAD * (2 * linkRng.nextDouble() - 1);
+		break;
+	case LATENCY_LOGNORMAL:
+		latency = par->LATENCY_MEAN * exp(par->LATENCY_SPREAD * linkRng.nextGaussian());
+		break;
+	default:
+		latency = par->LATENCY_MEAN;
+		break;
+	}
+	links[link] = max(1, (int)lround(latency));
+	return links[link];
+}
 
-	return size;
+/**
+ * FUNCTION NAME: ENdeliver
+ *
+ * DESCRIPTION: Move the queued messages whose latency has passed into their
+ * 				receivers' mailboxes, to be read this tick
+ */
+void EmulNet::ENdeliver() {
+	while ( !inflight.empty() && inflight.topDue() <= par->getcurrtime() ) {
+		deliver((en_msg *)inflight.pop(), par->getcurrtime());
+	}
+}
+
+/**
+ * FUNCTION NAME: ENnextDelivery
+ *
+ * DESCRIPTION: Tick the next queued message arrives at, or -1
+ */
+long EmulNet::ENnextDelivery() {
+	return inflight.topDue();
+}
+
+/**
+ * FUNCTION NAME: ENbatch
+ *
+ * DESCRIPTION: Make the calling thread's sends queue up in batch until
+ * 				ENflush, and its message storage come from and go back to
+ * 				cache; or post straight away and use the pool again if both
+ * 				are NULL
+ */
+void EmulNet::ENbatch(en_batch *batch, PoolCache *cache) {
+	outbox = batch;
+	pool.setCache(cache);
+}
+
+/**
+ * FUNCTION NAME: ENflush
+ *
+ * DESCRIPTION: Post and empty a batch filled by another thread, in send
+ * 				order, and give the blocks left in its cache back to the pool
+ */
+void EmulNet::ENflush(en_batch *batch, PoolCache *cache) {
+	for ( unsigned int i = 0; i < batch->size(); i++ ) {
+		post((*batch)[i]);
+	}
+	batch->clear();
+	pool.flushCache(cache);
+}
+
+/**
+ * FUNCTION NAME: ENwake
+ *
+ * DESCRIPTION: Wake the receiver of every message put into the network on
+ * 				wheel, the tick after it was sent. NULL stops it.
+ */
+void EmulNet::ENwake(TimerWheel *wheel) {
+	this->wheel = wheel;
+}
+
+/**
+ * FUNCTION NAME: ENmetrics
+ *
+ * DESCRIPTION: Count every message sent in metrics, by the thread that
+ * 				sends it. NULL stops it.
+ */
+void EmulNet::ENmetrics(Metrics *metrics) {
+	this->metrics = metrics;
+}
+
+/**
+ * FUNCTION NAME: ENtypeCount
+ *
+ * DESCRIPTION: Messages of type put into the network so far, and their bytes
+ */
+en_typecount EmulNet::ENtypeCount(int type) {
+	return stats.getType(type);
 }
 
 /**
@@ -126,52 +297,90 @@ int EmulNet::ENsend(Address *myaddr, Address *toaddr, char *data, int size) {
  * size
  */
 int EmulNet::ENsend(Address *myaddr, Address *toaddr, string data) {
-	char * str = (char *) malloc(data.length() * sizeof(char));
-	memcpy(str, data.c_str(), data.size());
-	int ret = this->ENsend(myaddr, toaddr, str, (data.length() * sizeof(char)));
-	free(str);
-	return ret;
+	return this->ENsend(myaddr, toaddr, (char *)data.c_str(), (data.length() * sizeof(char)));
+}
+
+/**
+ * FUNCTION NAME: getMailbox
+ *
+ * DESCRIPTION: Return the mailbox of the node with the given address.
+ * 				Ids that ENinit never handed out share mailbox 0, which no
+ * 				node reads, so such messages stay in the network as before.
+ */
+vector<int> &EmulNet::getMailbox(Address *addr) {
+	int id = *(int *)(addr->addr);
+
+	if ( id <= 0 || id >= emulnet.nextid ) {
+		id = 0;
+	}
+	if ( id >= (int)emulnet.mailbox.size() ) {
+		emulnet.mailbox.resize(emulnet.nextid);
+	}
+	return emulnet.mailbox[id];
+}
+
+/**
+ * FUNCTION NAME: removeMsg
+ *
+ * DESCRIPTION: Drop buff[i] from the network by moving the last message
+ * 				into its place, and point that message's mailbox entry at
+ * 				the new index
+ */
+void EmulNet::removeMsg(int i) {
+	int last = --emulnet.currbuffsize;
+	en_msg *moved;
+
+	if ( i != last ) {
+		moved = emulnet.buff[last];
+		emulnet.buff[i] = moved;
+		emulnet.mslot[i] = emulnet.mslot[last];
+		getMailbox(&moved->to)[emulnet.mslot[i]] = i;
+	}
 }
 
 /**
  * FUNCTION NAME: ENrecv
  *
  * DESCRIPTION: EmulNet receive function
+ * 				The payload is handed to enq in place as a MsgView, which
+ * 				gives the storage back to the pool once the receiver drops it.
+ * 				Only the messages in this node's mailbox are visited. By
+ * 				default they are delivered in the order the old full-buffer
+ * 				scan produced (descending buffer index, including the
+ * 				reordering caused by swap-with-last removal); with
+ * 				SWAP_ORDER set to 0 they are delivered newest first.
  *
  * RETURN:
  * 0
  */
-int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue){
+int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, MsgView), struct timeval *t, int times, void *queue){
 	// times is always assumed to be 1
-	int i;
-	char* tmp;
-	int sz;
+	int i, j;
 	en_msg *emsg;
+	vector<int> &box = getMailbox(myaddr);
+	vector<int> order;
 
-	for( i = emulnet.currbuffsize - 1; i >= 0; i-- ) {
-		emsg = emulnet.buff[i];
-
-		if ( 0 == strcmp(emsg->to.addr, myaddr->addr) ) {
-			sz = emsg->size;
-			tmp = (char *) malloc(sz * sizeof(char));
-			memcpy(tmp, (char *)(emsg+1), sz);
-
-			emulnet.buff[i] = emulnet.buff[emulnet.currbuffsize-1];
-			emulnet.currbuffsize--;
+	if ( box.empty() ) {
+		return 0;
+	}
 
-			(*enq)(queue, (char *)tmp, sz);
+	if ( par->SWAP_ORDER ) {
+		order = box;
+		sort(order.begin(), order.end(), greater<int>());
+	}
 
-			free(emsg);
+	for( j = box.size() - 1; j >= 0; j-- ) {
+		// indices in box move as messages are removed, so read them fresh
+		i = par->SWAP_ORDER ? order[box.size() - 1 - j] : box[j];
+		emsg = emulnet.buff[i];
 
-			int dst = *(int *)(myaddr->addr);
-			int time = par->getcurrtime();
+		removeMsg(i);
 
-			assert(dst <= MAX_NODES);
-			assert(time < MAX_TIME);
+		(*enq)(queue, MsgView(emsg, (char *)(emsg+1), emsg->size));
 
-			recv_msgs[dst][time]++;
-		}
+		stats.countRecv(*(int *)(myaddr->addr), par->getcurrtime());
 	}
+	box.clear();
 
 	return 0;
 }
@@ -183,38 +392,54 @@ int EmulNet::ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct ti
  */
 int EmulNet::ENcleanup() {
 	emulnet.nextid=0;
+	enInited=0;
 	int i, j;
 	int sent_total, recv_total;
+	en_count count;
 
 	FILE* file = fopen("msgcount.log", "w+");
 
 	while(emulnet.currbuffsize > 0) {
-		free(emulnet.buff[--emulnet.currbuffsize]);
+		MsgPool::release(emulnet.buff[--emulnet.currbuffsize]);
+	}
+	while ( !inflight.empty() ) {
+		MsgPool::release(inflight.pop());
 	}
+	emulnet.mailbox.clear();
 
 	for ( i = 1; i <= par->EN_GPSZ; i++ ) {
 		fprintf(file, "node %3d ", i);
 		sent_total = 0;
 		recv_total = 0;
 
-		for (j = 0; j < par->getcurrtime(); j++) {
+		for (j = 0; j < (par->getcurrtime() + stats.getWidth() - 1) / stats.getWidth(); j++) {
 
-			sent_total += sent_msgs[i][j];
-			recv_total += recv_msgs[i][j];
+			count = stats.get(i, j);
+			sent_total += count.sent;
+			recv_total += count.recv;
 			if (i != 67) {
-				fprintf(file, " (%4d, %4d)", sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, " (%4d, %4d)", count.sent, count.recv);
 				if (j % 10 == 9) {
 					fprintf(file, "\n         ");
 				}
 			}
 			else {
-				fprintf(file, "special %4d %4d %4d\n", j, sent_msgs[i][j], recv_msgs[i][j]);
+				fprintf(file, "special %4d %4d %4d\n", j, count.sent, count.recv);
 			}
 		}
 		fprintf(file, "\n");
 		fprintf(file, "node %3d sent_total %6u  recv_total %6u\n\n", i, sent_total, recv_total);
 	}
 
+	for ( i = 0; i < stats.getTypes(); i++ ) {
+		en_typecount type = stats.getType(i);
+		if ( type.msgs > 0 ) {
+			fprintf(file, "msgtype %2d sent %8ld bytes %10ld\n", i, type.msgs, type.bytes);
+		}
+	}
+	fprintf(file, "link drops partition %ld loss %ld burst %ld\n", faults.getDrops(LINK_PARTITION), faults.getDrops(LINK_LOSS), faults.getDrops(LINK_BURST));
+	fprintf(file, "pool messages %ld mallocs %ld\n", pool.getGets(), pool.getAllocs());
+
 	fclose(file);
 	return 0;
 }
@@ -7,13 +7,21 @@
 #ifndef _EMULNET_H_
 #define _EMULNET_H_
 
-#define MAX_NODES 1000
-#define MAX_TIME 3600
 #define ENBUFFSIZE 30000
+// message types above this are not tallied
+#define EN_MAXTYPES 64
+// longer runs count messages in columns of several ticks, to keep this many
+#define EN_STATS_COLUMNS 1000
 
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "MsgPool.h"
+#include "Random.h"
+#include "TimerWheel.h"
+#include "EventQueue.h"
+#include "LinkModel.h"
+#include "Metrics.h"
 
 using namespace std;
 
@@ -29,8 +37,21 @@ typedef struct en_msg {
 	Address to;
 }en_msg;
 
+/**
+ * Type Name: en_batch
+ *
+ * DESCRIPTION: Messages sent by a worker thread, in send order, waiting to
+ * 				be posted to the network at the tick barrier
+ */
+typedef vector<en_msg *> en_batch;
+
 /**
  * Class Name: EM
+ *
+ * DESCRIPTION: In-flight messages. buff holds every message in the network;
+ * 				mailbox[id] holds the buff indices of the messages addressed
+ * 				to node id, in send order, and mslot[i] is the position of
+ * 				buff[i] inside its mailbox.
  */
 class EM {
 public:
@@ -38,6 +59,8 @@ public:
 	int currbuffsize;
 	int firsteltindex;
 	en_msg* buff[ENBUFFSIZE];
+	int mslot[ENBUFFSIZE];
+	vector< vector<int> > mailbox;
 	EM() {}
 	EM& operator = (EM &anotherEM) {
 		this->nextid = anotherEM.getNextId();
@@ -46,8 +69,10 @@ public:
 		int i = this->currbuffsize;
 		while (i > 0) {
 			this->buff[i] = anotherEM.buff[i];
+			this->mslot[i] = anotherEM.mslot[i];
 			i--;
 		}
+		this->mailbox = anotherEM.mailbox;
 		return *this;
 	}
 	int getNextId() {
@@ -71,19 +96,133 @@ public:
 	virtual ~EM() {}
 };
 
+/**
+ * Struct Name: en_count
+ *
+ * DESCRIPTION: Messages a node sent and received in one tick
+ */
+typedef struct en_count {
+	int sent;
+	int recv;
+}en_count;
+
+/**
+ * Struct Name: en_typecount
+ *
+ * DESCRIPTION: Messages of one type put into the network, and their bytes
+ */
+typedef struct en_typecount {
+	long msgs;
+	long bytes;
+}en_typecount;
+
+/**
+ * Class Name: ENstats
+ *
+ * DESCRIPTION: Per-node message counts in columns of width ticks, one
+ * 				tick unless the run is long. Each node's row grows to the
+ * 				last column it was counted in, so memory follows the number
+ * 				of nodes and the length of the run. Sent messages are also
+ * 				tallied by type, the first int of their payload.
+ */
+class ENstats {
+private:
+	vector< vector<en_count> > counts;
+	vector<en_typecount> types;
+	int width;
+	en_count &at(int node, int time) {
+		time /= width;
+		if ( node >= (int)counts.size() ) {
+			counts.resize(node + 1);
+		}
+		if ( time >= (int)counts[node].size() ) {
+			counts[node].resize(time + 1, en_count());
+		}
+		return counts[node][time];
+	}
+public:
+	ENstats(): width(1) {}
+	void setWidth(int width) {
+		this->width = width;
+	}
+	int getWidth() {
+		return width;
+	}
+	void countSent(int node, int time) {
+		at(node, time).sent++;
+	}
+	void countRecv(int node, int time) {
+		at(node, time).recv++;
+	}
+	void countType(int type, int bytes) {
+		if ( type < 0 || type >= EN_MAXTYPES ) {
+			return;
+		}
+		if ( type >= (int)types.size() ) {
+			types.resize(type + 1, en_typecount());
+		}
+		types[type].msgs++;
+		types[type].bytes += bytes;
+	}
+	en_typecount getType(int type) {
+		if ( type >= 0 && type < (int)types.size() ) {
+			return types[type];
+		}
+		return en_typecount();
+	}
+	int getTypes() {
+		return types.size();
+	}
+	en_count get(int node, int column) {
+		if ( node < (int)counts.size() && column < (int)counts[node].size() ) {
+			return counts[node][column];
+		}
+		return en_count();
+	}
+};
+
 /**
  * CLASS NAME: EmulNet
  *
- * DESCRIPTION: This class defines an emulated network
+ * DESCRIPTION: This class defines an emulated network. By default a message
+ * 				is in its receiver's mailbox for the next tick. With a
+ * 				LATENCY other than LATENCY_NEXT_TICK each link (sender,
+ * 				receiver) draws its latency once from the configured
+ * 				distribution, and messages taking more than a tick wait in
+ * 				an event queue until ENdeliver moves them to the mailbox.
+ * 				A link's messages keep their order. Messages crossing a
+ * 				partition or lost on a lossy link are dropped by a
+ * 				LinkModel built from the config.
  */
 class EmulNet
 { 	
 private:
 	Params* par;
-	int sent_msgs[MAX_NODES + 1][MAX_TIME];
-	int recv_msgs[MAX_NODES + 1][MAX_TIME];
+	ENstats stats;
 	int enInited;
 	EM emulnet;
+	MsgPool pool;
+	// drop decisions
+	Random rng;
+	// wakes the receiver of each delivered message, keyed by node id
+	TimerWheel *wheel;
+	// messages waiting for their link latency to pass
+	EventQueue inflight;
+	// latency in ticks of each link used so far, keyed by sender and receiver id
+	map<long, int> links;
+	// link latency draws
+	Random linkRng;
+	// partitions and loss on links, from the config
+	LinkModel faults;
+	// counts the messages sent, when set
+	Metrics *metrics;
+	// batch the calling thread sends into, or NULL to post straight away
+	static thread_local en_batch *outbox;
+	vector<int> &getMailbox(Address *addr);
+	void removeMsg(int i);
+	int post(en_msg *em);
+	bool deliver(en_msg *em, int wake);
+	int linkLatency(Address *from, Address *to);
 public:
  	EmulNet(Params *p);
  	EmulNet(EmulNet &anotherEmulNet);
@@ -92,7 +231,14 @@ public:
 	void *ENinit(Address *myaddr, short port);
 	int ENsend(Address *myaddr, Address *toaddr, string data);
 	int ENsend(Address *myaddr, Address *toaddr, char *data, int size);
-	int ENrecv(Address *myaddr, int (* enq)(void *, char *, int), struct timeval *t, int times, void *queue);
+	int ENrecv(Address *myaddr, int (* enq)(void *, MsgView), struct timeval *t, int times, void *queue);
+	void ENbatch(en_batch *batch, PoolCache *cache);
+	void ENflush(en_batch *batch, PoolCache *cache);
+	void ENwake(TimerWheel *wheel);
+	void ENmetrics(Metrics *metrics);
+	void ENdeliver();
+	long ENnextDelivery();
+	en_typecount ENtypeCount(int type);
 	int ENcleanup();
 };
 
@@ -0,0 +1,281 @@
+/**********************************
+ * FILE NAME: EmulNetBench.cpp
+ *
+ * DESCRIPTION: Benchmark of EmulNet message delivery. Compares the
+ * 				per-destination mailboxes against the old full-buffer
+ * 				scan in ENrecv at 100, 1,000 and 10,000 nodes, then runs
+ * 				ticks the way Application does with BENCH_THREADS workers,
+ * 				getting and putting message storage with and without
+ * 				per-worker pool caches.
+ **********************************/
+
+#include "stdincludes.h"
+#include "Params.h"
+#include "Member.h"
+#include "EmulNet.h"
+#include "WorkerPool.h"
+#include <chrono>
+
+/*
+ * Macros
+ */
+#define BENCH_TICKS 3
+#define MSGS_PER_NODE 2
+#define BENCH_MSG_SIZE 64
+#define BENCH_THREADS 4
+#define THREADED_TICKS 20
+
+/**
+ * CLASS NAME: ScanNet
+ *
+ * DESCRIPTION: The previous EmulNet delivery path: a single buffer that
+ * 				every receive scans from end to start
+ */
+class ScanNet {
+public:
+	int currbuffsize;
+	en_msg* buff[ENBUFFSIZE];
+	ScanNet(): currbuffsize(0) {}
+	int send(Address *myaddr, Address *toaddr, char *data, int size) {
+		en_msg *em;
+
+		if ( currbuffsize >= ENBUFFSIZE ) {
+			return 0;
+		}
+		em = (en_msg *)malloc(sizeof(en_msg) + size);
+		em->size = size;
+		memcpy(&(em->from.addr), &(myaddr->addr), sizeof(em->from.addr));
+		memcpy(&(em->to.addr), &(toaddr->addr), sizeof(em->to.addr));
+		memcpy((char *)(em + 1), data, size);
+		buff[currbuffsize++] = em;
+		return size;
+	}
+	int recv(Address *myaddr, int (* enq)(void *, char *, int), void *queue) {
+		int i, sz;
+		char *tmp;
+		en_msg *emsg;
+
+		for ( i = currbuffsize - 1; i >= 0; i-- ) {
+			emsg = buff[i];
+			if ( 0 == strcmp(emsg->to.addr, myaddr->addr) ) {
+				sz = emsg->size;
+				tmp = (char *) malloc(sz * sizeof(char));
+				memcpy(tmp, (char *)(emsg+1), sz);
+				buff[i] = buff[currbuffsize-1];
+				currbuffsize--;
+				(*enq)(queue, tmp, sz);
+				free(emsg);
+			}
+		}
+		return 0;
+	}
+};
+
+/**
+ * FUNCTION NAME: drain
+ *
+ * DESCRIPTION: Receive callback that counts and frees each message
+ */
+static int drain(void *env, char *buff, int size) {
+	(*(long *)env)++;
+	free(buff);
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: drainView
+ *
+ * DESCRIPTION: Receive callback that counts each message; the view gives
+ * 				the storage back on return
+ */
+static int drainView(void *env, MsgView msg) {
+	(*(long *)env)++;
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: keepView
+ *
+ * DESCRIPTION: Receive callback that keeps each message in the node's
+ * 				queue, for a worker to drop
+ */
+static int keepView(void *env, MsgView msg) {
+	((vector<MsgView> *)env)->push_back(msg);
+	return 0;
+}
+
+/**
+ * FUNCTION NAME: elapsedMs
+ *
+ * DESCRIPTION: Milliseconds since start
+ */
+static double elapsedMs(chrono::steady_clock::time_point start) {
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * FUNCTION NAME: runBench
+ *
+ * DESCRIPTION: Run BENCH_TICKS ticks of MSGS_PER_NODE random sends per node
+ * 				followed by a receive at every node, on both networks
+ */
+static void runBench(int nodes) {
+	int i, t;
+	char data[BENCH_MSG_SIZE];
+	long delivered = 0, scanDelivered = 0;
+	double mailboxMs = 0, scanMs = 0;
+	vector<Address> addrs(nodes);
+	vector<int> dests(nodes * MSGS_PER_NODE);
+	Params par;
+	EmulNet *en;
+	ScanNet *scan = new ScanNet();
+
+	par.EN_GPSZ = nodes;
+	par.MAX_MSG_SIZE = 4000;
+	par.dropmsg = 0;
+	par.globaltime = 0;
+	par.SWAP_ORDER = 0;
+	par.SEED = 1;
+	par.LATENCY = LATENCY_NEXT_TICK;
+	par.RUN_TIME = BENCH_TICKS;
+	en = new EmulNet(&par);
+	memset(data, 0, sizeof(data));
+
+	for ( i = 0; i < nodes; i++ ) {
+		addrs[i].init();
+		en->ENinit(&addrs[i], par.PORTNUM);
+	}
+
+	for ( t = 0; t < BENCH_TICKS; t++ ) {
+		par.globaltime = t;
+		for ( i = 0; i < (int)dests.size(); i++ ) {
+			dests[i] = rand() % nodes;
+		}
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for ( i = 0; i < (int)dests.size(); i++ ) {
+			en->ENsend(&addrs[i / MSGS_PER_NODE], &addrs[dests[i]], data, sizeof(data));
+		}
+		for ( i = 0; i < nodes; i++ ) {
+			en->ENrecv(&addrs[i], drainView, NULL, 1, &delivered);
+		}
+		mailboxMs += elapsedMs(start);
+
+		start = chrono::steady_clock::now();
+		for ( i = 0; i < (int)dests.size(); i++ ) {
+			scan->send(&addrs[i / MSGS_PER_NODE], &addrs[dests[i]], data, sizeof(data));
+		}
+		for ( i = 0; i < nodes; i++ ) {
+			scan->recv(&addrs[i], drain, &scanDelivered);
+		}
+		scanMs += elapsedMs(start);
+	}
+
+	printf("nodes %6d  msgs/tick %6d  scan %10.3f ms/tick  mailbox %8.3f ms/tick  speedup %8.1fx\n",
+			nodes, (int)dests.size(), scanMs / BENCH_TICKS, mailboxMs / BENCH_TICKS, scanMs / mailboxMs);
+	if ( delivered != scanDelivered ) {
+		printf("delivered counts differ: mailbox %ld scan %ld\n", delivered, scanDelivered);
+	}
+
+	delete en;
+	delete scan;
+}
+
+/**
+ * FUNCTION NAME: runThreadedBench
+ *
+ * DESCRIPTION: Run THREADED_TICKS ticks on threads workers: each worker
+ * 				sends MSGS_PER_NODE messages per node of its share and
+ * 				drops the messages its nodes received, while the main
+ * 				thread posts the batches and receives at every node in
+ * 				between. With cached set the workers get and put in their
+ * 				own PoolCache, otherwise every get and put locks the pool.
+ * 				Returns the ms per tick spent in the workers.
+ */
+static double runThreadedBench(int nodes, int threads, bool cached) {
+	int i, t;
+	char data[BENCH_MSG_SIZE];
+	double ms = 0;
+	long sent = 0;
+	vector<Address> addrs(nodes);
+	vector<vector<MsgView> > queues(nodes);
+	Params par;
+	EmulNet *en;
+	WorkerPool workers(threads);
+	vector<en_batch> sends(workers.size());
+	vector<PoolCache> blocks(workers.size());
+
+	par.EN_GPSZ = nodes;
+	par.MAX_MSG_SIZE = 4000;
+	par.dropmsg = 0;
+	par.globaltime = 0;
+	par.SWAP_ORDER = 0;
+	par.SEED = 1;
+	par.LATENCY = LATENCY_NEXT_TICK;
+	par.RUN_TIME = THREADED_TICKS;
+	en = new EmulNet(&par);
+	memset(data, 0, sizeof(data));
+	memset(blocks.data(), 0, blocks.size() * sizeof(PoolCache));
+
+	for ( i = 0; i < nodes; i++ ) {
+		addrs[i].init();
+		en->ENinit(&addrs[i], par.PORTNUM);
+	}
+
+	for ( t = 0; t < THREADED_TICKS; t++ ) {
+		par.globaltime = t;
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		workers.run([&](int worker) {
+			int first = (long)nodes * worker / sends.size();
+			int last = (long)nodes * (worker + 1) / sends.size();
+
+			en->ENbatch(&sends[worker], cached ? &blocks[worker] : NULL);
+			for ( int n = first; n < last; n++ ) {
+				queues[n].clear();
+				for ( int m = 0; m < MSGS_PER_NODE; m++ ) {
+					en->ENsend(&addrs[n], &addrs[(n * 7 + m * 13 + t) % nodes], data, sizeof(data));
+				}
+			}
+			en->ENbatch(NULL, NULL);
+		});
+		ms += elapsedMs(start);
+
+		for ( i = 0; i < (int)sends.size(); i++ ) {
+			sent += sends[i].size();
+			en->ENflush(&sends[i], &blocks[i]);
+		}
+		for ( i = 0; i < nodes; i++ ) {
+			en->ENrecv(&addrs[i], keepView, NULL, 1, &queues[i]);
+		}
+	}
+
+	if ( sent != (long)nodes * MSGS_PER_NODE * THREADED_TICKS ) {
+		printf("sent %ld messages, expected %ld\n", sent, (long)nodes * MSGS_PER_NODE * THREADED_TICKS);
+	}
+	queues.clear();
+	delete en;
+	return ms / THREADED_TICKS;
+}
+
+/**********************************
+ * FUNCTION NAME: main
+ *
+ * DESCRIPTION: main function. Start from here
+ **********************************/
+int main(int argc, char *argv[]) {
+	int sizes[] = { 100, 1000, 10000 };
+
+	srand(1);
+	for ( unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++ ) {
+		runBench(sizes[i]);
+	}
+	for ( unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++ ) {
+		double single = runThreadedBench(sizes[i], 1, true);
+		double locked = runThreadedBench(sizes[i], BENCH_THREADS, false);
+		double cached = runThreadedBench(sizes[i], BENCH_THREADS, true);
+		printf("nodes %6d  threads %d  1 thread %8.3f ms/tick  locked pool %8.3f ms/tick  cached pool %8.3f ms/tick\n",
+				sizes[i], BENCH_THREADS, single, locked, cached);
+	}
+	return SUCCESS;
+}
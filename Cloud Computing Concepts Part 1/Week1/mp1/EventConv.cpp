@@ -0,0 +1,83 @@
+/**********************************
+ * FILE NAME: EventConv.cpp
+ *
+ * DESCRIPTION: Renders an events.bin written with EVENT_LOG set as the
+ * 				lines dbg.log would have had for its events, so Grader.sh
+ * 				and anything else that reads dbg.log can use it.
+ *
+ * 				Usage: ./EventConv events.bin [dbg.log]
+ **********************************/
+
+#include "stdincludes.h"
+#include "EventLog.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * FUNCTION NAME: main
+ *
+ * DESCRIPTION: Map the event file, check its header and write one line per
+ * 				record to the output file, stdout if none is given
+ */
+int main(int argc, char *argv[]) {
+	struct stat info;
+	const char *data;
+	const EventFileHeader *header;
+	const EventRecord *events;
+	size_t count;
+	FILE *out = stdout;
+	char prefix[64];
+	char text[100];
+	int fd;
+
+	if ( argc < 2 || argc > 3 ) {
+		fprintf(stderr, "Usage: %s events.bin [dbg.log]\n", argv[0]);
+		return FAILURE;
+	}
+
+	fd = open(argv[1], O_RDONLY);
+	if ( fd < 0 || fstat(fd, &info) < 0 ) {
+		perror(argv[1]);
+		return FAILURE;
+	}
+	if ( (size_t)info.st_size < sizeof(EventFileHeader) ) {
+		fprintf(stderr, "%s: too short for an event file\n", argv[1]);
+		return FAILURE;
+	}
+	data = (const char *)mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if ( data == MAP_FAILED ) {
+		perror(argv[1]);
+		return FAILURE;
+	}
+
+	header = (const EventFileHeader *)data;
+	if ( memcmp(header->magic, EVENT_MAGIC, sizeof(EVENT_MAGIC)) != 0 || header->version != EVENT_VERSION || header->recordSize != sizeof(EventRecord) ) {
+		fprintf(stderr, "%s: not a version %d event file\n", argv[1], EVENT_VERSION);
+		return FAILURE;
+	}
+	events = (const EventRecord *)(data + sizeof(EventFileHeader));
+	count = (info.st_size - sizeof(EventFileHeader)) / sizeof(EventRecord);
+
+	if ( argc == 3 && (out = fopen(argv[2], "w")) == NULL ) {
+		perror(argv[2]);
+		return FAILURE;
+	}
+
+	fprintf(out, "%x\n", EventLog::magicNumber());
+	for ( size_t i = 0; i < count; i++ ) {
+		char observer[6];
+		EventLog::address(events[i].observer, observer);
+		EventLog::linePrefix(prefix, sizeof(prefix), observer, events[i].time);
+		EventLog::describe(&events[i], text, sizeof(text));
+		fputs(prefix, out);
+		fputs(text, out);
+	}
+
+	if ( out != stdout ) {
+		fclose(out);
+	}
+	munmap((void *)data, info.st_size);
+	close(fd);
+	return SUCCESS;
+}
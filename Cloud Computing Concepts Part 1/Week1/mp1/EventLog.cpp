@@ -0,0 +1,113 @@
+/**********************************
+ * FILE NAME: EventLog.cpp
+ *
+ * DESCRIPTION: Definition of the membership event records
+ **********************************/
+
+#include "EventLog.h"
+
+/**
+ * FUNCTION NAME: make
+ *
+ * DESCRIPTION: The record of an event between two 6-byte addresses
+ */
+EventRecord EventLog::make(int type, const char *observer, const char *subject, int time) {
+	EventRecord event;
+	int id;
+
+	memset(&event, 0, sizeof(event));
+	event.time = time;
+	event.type = type;
+	memcpy(&id, observer, sizeof(int));
+	event.observer = (unsigned short)id;
+	memcpy(&id, subject, sizeof(int));
+	event.subject = (unsigned short)id;
+	return event;
+}
+
+/**
+ * FUNCTION NAME: address
+ *
+ * DESCRIPTION: Write the 6-byte address of the node with this id into addr
+ */
+void EventLog::address(unsigned short id, char *addr) {
+	int full = id;
+	short port = 0;
+
+	memcpy(addr, &full, sizeof(int));
+	memcpy(addr + sizeof(int), &port, sizeof(short));
+}
+
+/**
+ * FUNCTION NAME: describe
+ *
+ * DESCRIPTION: Write the message of an event's dbg.log line into buf
+ *
+ * RETURNS:
+ * its length, as snprintf
+ */
+int EventLog::describe(const EventRecord *event, char *buf, size_t size) {
+	char subject[6];
+	int time = event->time;
+
+	address(event->subject, subject);
+
+	switch ( event->type ) {
+	case EVENT_JOIN:
+		return snprintf(buf, size, "Node %d.%d.%d.%d:%d joined at time %d", subject[0], subject[1], subject[2], subject[3], *(short *)&subject[4], time);
+	case EVENT_REMOVE:
+		return snprintf(buf, size, "Node %d.%d.%d.%d:%d removed at time %d", subject[0], subject[1], subject[2], subject[3], *(short *)&subject[4], time);
+	case EVENT_FAIL:
+		return snprintf(buf, size, "Node failed at time=%d", time);
+	case EVENT_LEAVE:
+		return snprintf(buf, size, "Node left at time=%d", time);
+	case EVENT_RESTART:
+		return snprintf(buf, size, "Node restarted at time=%d", time);
+	default:
+		return snprintf(buf, size, "Unknown event %d", (int)event->type);
+	}
+}
+
+/**
+ * FUNCTION NAME: linePrefix
+ *
+ * DESCRIPTION: Write the start of a dbg.log line, the logging node's
+ * 				address and the time, into buf
+ *
+ * RETURNS:
+ * its length, as snprintf
+ */
+int EventLog::linePrefix(char *buf, size_t size, const char *addr, int time) {
+	return snprintf(buf, size, "\n %d.%d.%d.%d:%d [%d] ", addr[0], addr[1], addr[2], addr[3], *(short *)&addr[4], time);
+}
+
+/**
+ * FUNCTION NAME: magicNumber
+ *
+ * DESCRIPTION: The number dbg.log starts with, in hex on a line of its own
+ */
+int EventLog::magicNumber() {
+	int magicNumber = 0;
+	string magic = MAGIC_NUMBER;
+	int len = magic.length();
+
+	for ( int i = 0; i < len; i++ ) {
+		magicNumber += (int)magic.at(i);
+	}
+	return magicNumber;
+}
+
+/**
+ * FUNCTION NAME: header
+ *
+ * DESCRIPTION: The header an event file starts with
+ */
+EventFileHeader EventLog::header() {
+	EventFileHeader header;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, EVENT_MAGIC, sizeof(EVENT_MAGIC));
+	header.version = EVENT_VERSION;
+	header.recordSize = sizeof(EventRecord);
+	return header;
+}
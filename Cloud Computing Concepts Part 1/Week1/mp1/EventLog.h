@@ -0,0 +1,74 @@
+/**********************************
+ * FILE NAME: EventLog.h
+ *
+ * DESCRIPTION: Header file of the binary membership event records and
+ * 				their dbg.log text form
+ **********************************/
+
+#ifndef _EVENTLOG_H_
+#define _EVENTLOG_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+#define MAGIC_NUMBER "CS425"
+#define EVENTS_LOG "events.bin"
+// first bytes of an event file, then the format version and the record size
+#define EVENT_MAGIC "MP1EVTS"
+#define EVENT_VERSION 2
+// largest node id and time a record holds; with more nodes or a longer run
+// dbg.log is written as text
+#define EVENT_MAX_ID 0xffff
+#define EVENT_MAX_TIME 0xffffff
+
+// what happened, as seen by the observer
+enum eventTYPE { EVENT_JOIN, EVENT_REMOVE, EVENT_FAIL, EVENT_LEAVE, EVENT_RESTART };
+
+/**
+ * STRUCT NAME: EventFileHeader
+ *
+ * DESCRIPTION: Start of an event file. Records follow from offset 16, so a
+ * 				mapped file is an array of them.
+ */
+typedef struct EventFileHeader {
+	char magic[8];
+	unsigned int version;
+	unsigned int recordSize;
+}EventFileHeader;
+
+/**
+ * STRUCT NAME: EventRecord
+ *
+ * DESCRIPTION: One membership event, in 8 bytes: at time, observer saw
+ * 				subject join or be removed. Failures, leaves and restarts
+ * 				are injected by the application and have the node as both
+ * 				observer and subject. Nodes are kept by the id of their
+ * 				Address; the port, always 0 in the emulated network, is
+ * 				not stored.
+ */
+typedef struct EventRecord {
+	unsigned int time : 24;
+	unsigned int type : 8;
+	unsigned short observer;
+	unsigned short subject;
+}EventRecord;
+
+/**
+ * CLASS NAME: EventLog
+ *
+ * DESCRIPTION: Builds event records and renders them, or any log line,
+ * 				the way dbg.log has them
+ */
+class EventLog {
+public:
+	static EventRecord make(int type, const char *observer, const char *subject, int time);
+	static void address(unsigned short id, char *addr);
+	static int describe(const EventRecord *event, char *buf, size_t size);
+	static int linePrefix(char *buf, size_t size, const char *addr, int time);
+	static int magicNumber();
+	static EventFileHeader header();
+};
+
+#endif /* _EVENTLOG_H_ */
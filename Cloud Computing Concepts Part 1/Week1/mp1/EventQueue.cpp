@@ -0,0 +1,105 @@
+/**********************************
+ * FILE NAME: EventQueue.cpp
+ *
+ * DESCRIPTION: Definition of the pairing heap of timed events
+ **********************************/
+
+#include "EventQueue.h"
+
+/**
+ * Destructor
+ * Items still queued are not freed; they belong to the caller
+ */
+EventQueue::~EventQueue() {
+	while ( root ) {
+		pop();
+	}
+	for ( unsigned int i = 0; i < spare.size(); i++ ) {
+		delete spare[i];
+	}
+}
+
+/**
+ * FUNCTION NAME: meld
+ *
+ * DESCRIPTION: Join two heaps by making the later root the first child of
+ * 				the earlier one
+ */
+Event *EventQueue::meld(Event *a, Event *b) {
+	if ( a == NULL ) {
+		return b;
+	}
+	if ( b == NULL ) {
+		return a;
+	}
+	if ( before(b, a) ) {
+		swap(a, b);
+	}
+	b->sibling = a->child;
+	a->child = b;
+	return a;
+}
+
+/**
+ * FUNCTION NAME: push
+ *
+ * DESCRIPTION: Queue item to come out at tick due
+ */
+void EventQueue::push(long due, void *item) {
+	Event *event;
+
+	if ( spare.empty() ) {
+		event = new Event;
+	}
+	else {
+		event = spare.back();
+		spare.pop_back();
+	}
+	event->due = due;
+	event->seq = nextSeq++;
+	event->item = item;
+	event->child = NULL;
+	event->sibling = NULL;
+	root = meld(root, event);
+	count++;
+}
+
+/**
+ * FUNCTION NAME: pop
+ *
+ * DESCRIPTION: Remove and return the first item. The root's children are
+ * 				melded in pairs left to right, then the pairs right to left.
+ */
+void *EventQueue::pop() {
+	Event *first = root;
+	Event *child, *next;
+	void *item;
+
+	if ( first == NULL ) {
+		return NULL;
+	}
+	item = first->item;
+
+	pairs.clear();
+	for ( child = first->child; child != NULL; child = next ) {
+		next = child->sibling;
+		child->sibling = NULL;
+		if ( next != NULL ) {
+			Event *after = next->sibling;
+			next->sibling = NULL;
+			pairs.push_back(meld(child, next));
+			next = after;
+		}
+		else {
+			pairs.push_back(child);
+		}
+	}
+	root = NULL;
+	for ( int i = (int)pairs.size() - 1; i >= 0; i-- ) {
+		root = meld(pairs[i], root);
+	}
+
+	spare.push_back(first);
+	count--;
+	return item;
+}
@@ -0,0 +1,66 @@
+/**********************************
+ * FILE NAME: EventQueue.h
+ *
+ * DESCRIPTION: Header file of the priority queue of timed events
+ **********************************/
+
+#ifndef _EVENTQUEUE_H_
+#define _EVENTQUEUE_H_
+
+#include "stdincludes.h"
+
+/**
+ * STRUCT NAME: Event
+ *
+ * DESCRIPTION: A node of the pairing heap: an item due at tick due. seq
+ * 				breaks ties in push order.
+ */
+typedef struct Event {
+	long due;
+	long seq;
+	void *item;
+	// first child and next sibling in the heap
+	struct Event *child;
+	struct Event *sibling;
+}Event;
+
+/**
+ * CLASS NAME: EventQueue
+ *
+ * DESCRIPTION: Pairing heap of items ordered by due tick, then by push
+ * 				order, so equal runs pop the same items in the same order.
+ * 				push and top are O(1), pop is O(log n) amortized. Popped
+ * 				nodes are kept for reuse.
+ */
+class EventQueue {
+private:
+	Event *root;
+	long count;
+	long nextSeq;
+	vector<Event *> spare;
+	// children of the popped root, paired up by pop
+	vector<Event *> pairs;
+	static bool before(Event *a, Event *b) {
+		return a->due < b->due || (a->due == b->due && a->seq < b->seq);
+	}
+	static Event *meld(Event *a, Event *b);
+public:
+	EventQueue(): root(NULL), count(0), nextSeq(0) {}
+	EventQueue(const EventQueue &anotherQueue) = delete;
+	EventQueue& operator = (const EventQueue &anotherQueue) = delete;
+	virtual ~EventQueue();
+	void push(long due, void *item);
+	void *pop();
+	bool empty() {
+		return root == NULL;
+	}
+	// due tick of the first item, or -1 if empty
+	long topDue() {
+		return root ? root->due : -1;
+	}
+	long size() {
+		return count;
+	}
+};
+
+#endif /* _EVENTQUEUE_H_ */
@@ -0,0 +1,213 @@
+/**********************************
+ * FILE NAME: LinkModel.cpp
+ *
+ * DESCRIPTION: Definition of the link fault model
+ **********************************/
+
+#include "LinkModel.h"
+
+/**
+ * FUNCTION NAME: init
+ *
+ * DESCRIPTION: Read the GROUP lines and queue the start and end of every
+ * 				PARTITION, LOSS and BURST window. Lines with too few values
+ * 				or a group out of range are ignored.
+ */
+void LinkModel::init(Params *par) {
+	rng.seed(par->SEED, RNG_STREAM_FAULT);
+	memset(links, 0, sizeof(links));
+	memset(cuts, 0, sizeof(cuts));
+	memset(cut, 0, sizeof(cut));
+	memset(drops, 0, sizeof(drops));
+	open.clear();
+	group.clear();
+	actions.clear();
+	nextAction = 0;
+	active = 0;
+
+	for ( unsigned int i = 0; i < par->linkFaults.size(); i++ ) {
+		const ConfLine *conf = &par->linkFaults[i];
+		const vector<double> &v = conf->values;
+		unsigned int need;
+		bool valid;
+
+		if ( conf->key == "GROUP" ) {
+			if ( v.size() < 3 || !validGroup(v[0], false) || v[1] < 0 || v[2] < v[1] ) {
+				continue;
+			}
+			if ( (int)v[2] >= (int)group.size() ) {
+				group.resize((int)v[2] + 1, 0);
+			}
+			for ( int id = (int)v[1]; id <= (int)v[2]; id++ ) {
+				group[id] = (unsigned char)v[0];
+			}
+			continue;
+		}
+
+		need = conf->key == "PARTITION" ? 4 : conf->key == "LOSS" ? 5 : 7;
+		valid = v.size() >= need && v[1] > v[0]
+				&& validGroup(v[2], conf->key != "PARTITION") && validGroup(v[3], true);
+		if ( !valid ) {
+			continue;
+		}
+		LinkAction start = { (long)v[0], (int)i, conf, true };
+		LinkAction end = { (long)v[1], (int)i, conf, false };
+		actions.push_back(start);
+		actions.push_back(end);
+	}
+
+	// ends go first on a tick, so back to back windows on the same links do not overlap
+	sort(actions.begin(), actions.end(), [](const LinkAction &a, const LinkAction &b) {
+		if ( a.time != b.time ) {
+			return a.time < b.time;
+		}
+		if ( a.start != b.start ) {
+			return !a.start;
+		}
+		return a.seq < b.seq;
+	});
+}
+
+/**
+ * FUNCTION NAME: advance
+ *
+ * DESCRIPTION: Open and close the windows that start or end by tick now
+ */
+void LinkModel::advance(long now) {
+	while ( nextAction < actions.size() && actions[nextAction].time <= now ) {
+		apply(actions[nextAction].conf, actions[nextAction].start);
+		active += actions[nextAction].start ? 1 : -1;
+		nextAction++;
+	}
+}
+
+/**
+ * FUNCTION NAME: apply
+ *
+ * DESCRIPTION: Open (start) or close a PARTITION, LOSS or BURST window
+ */
+void LinkModel::apply(const ConfLine *conf, bool start) {
+	int a = (int)conf->values[2];
+	int b = (int)conf->values[3];
+	int delta = start ? 1 : -1;
+
+	if ( conf->key == "PARTITION" ) {
+		for ( int g = 0; g < LINK_GROUPS; g++ ) {
+			if ( b == LINK_ANY ? g != a : g == b ) {
+				setCut(a, g, delta);
+				setCut(g, a, delta);
+			}
+		}
+		return;
+	}
+	for ( int from = 0; from < LINK_GROUPS; from++ ) {
+		if ( a != LINK_ANY && from != a ) {
+			continue;
+		}
+		for ( int to = 0; to < LINK_GROUPS; to++ ) {
+			if ( b == LINK_ANY || to == b ) {
+				setLoss(conf, from, to, start);
+			}
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: setCut
+ *
+ * DESCRIPTION: Add delta partitions between group a and group b, keeping
+ * 				the bitmap in step with the count
+ */
+void LinkModel::setCut(int a, int b, int delta) {
+	cuts[a][b] += delta;
+	if ( cuts[a][b] > 0 ) {
+		cut[a] |= (uint64_t)1 << b;
+	}
+	else {
+		cut[a] &= ~((uint64_t)1 << b);
+	}
+}
+
+/**
+ * FUNCTION NAME: setLoss
+ *
+ * DESCRIPTION: Open or close a LOSS or BURST line on the links from group
+ * 				from to group to. The latest line to start wins while windows
+ * 				overlap; when it closes, the latest one still open is put
+ * 				back, or the links are cleared if none is.
+ */
+void LinkModel::setLoss(const ConfLine *conf, int from, int to, bool start) {
+	LinkState *link = &links[from][to];
+	bool burst = conf->key == "BURST";
+	vector<const ConfLine *> &lines = open[openKey(from, to, burst)];
+	const ConfLine *top = lines.empty() ? NULL : lines.back();
+
+	if ( start ) {
+		lines.push_back(conf);
+	}
+	else {
+		lines.erase(find(lines.begin(), lines.end(), conf));
+	}
+	if ( !lines.empty() && lines.back() == top ) {
+		return;
+	}
+	top = lines.empty() ? NULL : lines.back();
+
+	if ( !burst ) {
+		link->loss = top ? top->values[4] : 0;
+		return;
+	}
+	link->burst = top != NULL;
+	link->toBad = top ? top->values[4] : 0;
+	link->toGood = top ? top->values[5] : 0;
+	link->badLoss = top ? top->values[6] : 0;
+	link->bad = false;
+}
+
+/**
+ * FUNCTION NAME: drop
+ *
+ * DESCRIPTION: Decide whether a message sent at tick now from node fromId
+ * 				to node toId is lost on its link
+ *
+ * RETURNS:
+ * LINK_DELIVER, or the linkDROP cause it was dropped for
+ */
+int LinkModel::drop(int fromId, int toId, long now) {
+	int from, to;
+	LinkState *link;
+	double loss;
+
+	if ( nextAction < actions.size() && actions[nextAction].time <= now ) {
+		advance(now);
+	}
+	if ( active == 0 ) {
+		return LINK_DELIVER;
+	}
+
+	from = groupOf(fromId);
+	to = groupOf(toId);
+	if ( (cut[from] >> to) & 1 ) {
+		drops[LINK_PARTITION]++;
+		return LINK_PARTITION;
+	}
+
+	link = &links[from][to];
+	loss = link->loss;
+	if ( link->burst ) {
+		if ( link->bad ) {
+			link->bad = rng.nextDouble() >= link->toGood;
+		}
+		else {
+			link->bad = rng.nextDouble() < link->toBad;
+		}
+		if ( link->bad ) {
+			loss = link->badLoss;
+		}
+	}
+	if ( loss > 0 && rng.nextDouble() < loss ) {
+		drops[link->bad ? LINK_BURST : LINK_LOSS]++;
+		return link->bad ? LINK_BURST : LINK_LOSS;
+	}
+	return LINK_DELIVER;
+}
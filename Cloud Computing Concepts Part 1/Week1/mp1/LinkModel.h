@@ -0,0 +1,106 @@
+/**********************************
+ * FILE NAME: LinkModel.h
+ *
+ * DESCRIPTION: Header file of the link fault model of the emulated network
+ **********************************/
+
+#ifndef _LINKMODEL_H_
+#define _LINKMODEL_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+#include "Random.h"
+
+/*
+ * Macros
+ */
+// groups are numbered 0..LINK_GROUPS-1, so a group's cuts fit one bitmap
+#define LINK_GROUPS 64
+// matches every group in a LOSS or BURST line, or every other group in a PARTITION
+#define LINK_ANY -1
+
+// why a message was dropped
+enum linkDROP { LINK_DELIVER, LINK_PARTITION, LINK_LOSS, LINK_BURST, LINK_DROPS };
+
+/**
+ * STRUCT NAME: LinkState
+ *
+ * DESCRIPTION: Loss on the links from one group to another. While burst is
+ * 				set the links follow a Gilbert-Elliott chain: each message
+ * 				first moves them good to bad with toBad or bad to good with
+ * 				toGood, then is lost with loss when good or badLoss when bad.
+ */
+typedef struct LinkState {
+	double loss;
+	bool burst;
+	double toBad;
+	double toGood;
+	double badLoss;
+	bool bad;
+}LinkState;
+
+/**
+ * STRUCT NAME: LinkAction
+ *
+ * DESCRIPTION: The start or end of a fault window read from the config
+ */
+typedef struct LinkAction {
+	long time;
+	// position in the config, to apply actions of the same tick in file order
+	int seq;
+	const ConfLine *conf;
+	bool start;
+}LinkAction;
+
+/**
+ * CLASS NAME: LinkModel
+ *
+ * DESCRIPTION: Partitions, per-link loss and burst loss between groups of
+ * 				nodes, switched on and off at the ticks given in the config.
+ * 				State is kept per pair of groups, never per pair of nodes:
+ * 				each group's partitions are a 64-bit map of the groups it is
+ * 				cut from, so a lookup costs two array reads and, only on
+ * 				lossy links, a random draw. With no fault active nothing is
+ * 				drawn, so such runs match runs without the model.
+ */
+class LinkModel {
+private:
+	// group of each node id; ids past the end are in group 0
+	vector<unsigned char> group;
+	LinkState links[LINK_GROUPS][LINK_GROUPS];
+	// partitions covering each pair of groups, and bit b of cut[a] set if any
+	unsigned short cuts[LINK_GROUPS][LINK_GROUPS];
+	uint64_t cut[LINK_GROUPS];
+	// LOSS and BURST lines open on each pair of groups, in the order they
+	// started, keyed by openKey; the last one sets the link's state
+	map<int, vector<const ConfLine *> > open;
+	// fault windows by time, and the next one to apply
+	vector<LinkAction> actions;
+	unsigned int nextAction;
+	// fault windows open now
+	int active;
+	long drops[LINK_DROPS];
+	Random rng;
+	int groupOf(int id) {
+		return id >= 0 && id < (int)group.size() ? group[id] : 0;
+	}
+	static int openKey(int from, int to, bool burst) {
+		return (from * LINK_GROUPS + to) * 2 + (burst ? 1 : 0);
+	}
+	static bool validGroup(double g, bool any) {
+		return (g >= 0 && g < LINK_GROUPS) || (any && g == LINK_ANY);
+	}
+	void advance(long now);
+	void apply(const ConfLine *conf, bool start);
+	void setCut(int a, int b, int delta);
+	void setLoss(const ConfLine *conf, int from, int to, bool start);
+public:
+	LinkModel(): nextAction(0), active(0) {}
+	void init(Params *par);
+	int drop(int fromId, int toId, long now);
+	long getDrops(int cause) {
+		return drops[cause];
+	}
+};
+
+#endif /* _LINKMODEL_H_ */
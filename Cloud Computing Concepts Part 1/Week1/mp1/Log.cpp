@@ -6,106 +6,364 @@
 
 #include "Log.h"
 
+thread_local LogBatch *Log::batch = NULL;
+thread_local ThreadChunk Log::chunk = { NULL, NULL, 0 };
+thread_local bool Log::writerThread = false;
+Log *Log::current = NULL;
+
 /**
  * Constructor
  */
-Log::Log(Params *p) {
+Log::Log(Params *p): ring(LOG_RING_SLOTS), writerSleeping(false), waiting(0), stopping(false), closed(false), finished(false) {
+	static bool registered = false;
+
 	par = p;
 	firstTime = false;
+	dbg = fopen(DBG_LOG, "w");
+	stats = fopen(STATS_LOG, "w");
+	events = NULL;
+	if ( par->EVENT_LOG ) {
+		EventFileHeader header = EventLog::header();
+		events = fopen(EVENTS_LOG, "wb");
+		fwrite(&header, sizeof(header), 1, events);
+	}
+	writer = thread(&Log::write, this);
+
+	current = this;
+	if ( !registered ) {
+		atexit(closeCurrent);
+		signal(SIGSEGV, drainCurrent);
+		signal(SIGBUS, drainCurrent);
+		signal(SIGFPE, drainCurrent);
+		signal(SIGILL, drainCurrent);
+		signal(SIGABRT, drainCurrent);
+		signal(SIGINT, drainCurrent);
+		signal(SIGTERM, drainCurrent);
+		registered = true;
+	}
 }
 
 /**
- * Copy constructor
+ * Destructor
  */
-Log::Log(const Log &anotherLog) {
-	this->par = anotherLog.par;
-	this->firstTime = anotherLog.firstTime;
+Log::~Log() {
+	close();
 }
 
 /**
- * Assignment Operator Overloading
+ * FUNCTION NAME: LOG
+ *
+ * DESCRIPTION: Log a line to dbg.log, or to stats.log if it starts with
+ * 				#STATSLOG#, along with the Address of node. The line is
+ * 				kept as a record in the calling thread's batch if it has
+ * 				one, or its own chunk otherwise.
  */
-Log& Log::operator = (const Log& anotherLog) {
-	this->par = anotherLog.par;
-	this->firstTime = anotherLog.firstTime;
-	return *this;
+void Log::LOG(Address *addr, const char * str, ...) {
+
+	va_list vararglist;
+	char buffer[30000];
+	int length;
+
+	va_start(vararglist, str);
+	length = vsnprintf(buffer, sizeof(buffer), str, vararglist);
+	va_end(vararglist);
+
+	append(memcmp(buffer, "#STATSLOG#", 10) == 0 ? LOG_STATS : LOG_DBG, addr, buffer, max(0, min(length, (int)sizeof(buffer) - 1)));
 }
 
 /**
- * Destructor
+ * FUNCTION NAME: append
+ *
+ * DESCRIPTION: Add a record for file to the calling thread's records, and
+ * 				queue its chunk once full
  */
-Log::~Log() {}
+void Log::append(int file, Address *addr, const char *data, int length) {
+	LogRecord record;
+
+	record.file = (unsigned char)file;
+	memcpy(record.addr, addr->addr, sizeof(record.addr));
+	record.time = par->getcurrtime();
+	record.length = length;
+
+	LogChunk &records = this->records();
+	chunk.appending = 1;
+	records.insert(records.end(), (char *)&record, (char *)&record + sizeof(LogRecord));
+	records.insert(records.end(), data, data + length);
+	chunk.appending = 0;
+
+	if ( !batch && chunk.records->size() >= LOG_CHUNK_SIZE ) {
+		submit(chunk.records);
+		chunk.records = NULL;
+	}
+}
 
 /**
- * FUNCTION NAME: LOG
+ * FUNCTION NAME: records
  *
- * DESCRIPTION: Print out to file dbg.log, along with Address of node.
+ * DESCRIPTION: Where the calling thread's records go: its batch, or its
+ * 				own chunk, started if it has none
  */
-void Log::LOG(Address *addr, const char * str, ...) {
+LogChunk &Log::records() {
+	if ( batch ) {
+		return batch->records;
+	}
+	if ( chunk.records == NULL ) {
+		chunk.records = new LogChunk;
+		chunk.records->reserve(LOG_CHUNK_SIZE + 1024);
+	}
+	chunk.log = this;
+	return *chunk.records;
+}
 
-	static FILE *fp;
-	static FILE *fp2;
-	va_list vararglist;
-	static char buffer[30000];
-	static int numwrites;
-	static char stdstring[30];
-	static char stdstring2[40];
-	static char stdstring3[40]; 
-	static int dbg_opened=0;
+/**
+ * FUNCTION NAME: submit
+ *
+ * DESCRIPTION: Queue a chunk for the writer, which frees it. While the
+ * 				ring is full the caller waits for the writer to free a cell.
+ */
+void Log::submit(LogChunk *full) {
+	while ( !ring.push(full) ) {
+		unique_lock<mutex> guard(lock);
+		waiting++;
+		drained.wait_for(guard, chrono::milliseconds(1));
+		waiting--;
+	}
+	if ( writerSleeping ) {
+		lock_guard<mutex> guard(lock);
+		filled.notify_one();
+	}
+}
 
-	if(dbg_opened != 639){
-		numwrites=0;
+/**
+ * FUNCTION NAME: write
+ *
+ * DESCRIPTION: Body of the writer thread: format the queued chunks in
+ * 				order, write out what it gathered whenever the ring runs
+ * 				dry, and sleep until the next chunk. Returns once close
+ * 				asks it to and the ring is empty.
+ */
+void Log::write() {
+	LogChunk *next;
+	LogRecord record;
+	sigset_t stop;
 
-		stdstring2[0]=0;
+	// SIGINT and SIGTERM go to a thread that can wait for this one
+	writerThread = true;
+	sigemptyset(&stop);
+	sigaddset(&stop, SIGINT);
+	sigaddset(&stop, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &stop, NULL);
 
-		strcpy(stdstring3, stdstring2);
+	while ( true ) {
+		next = ring.pop();
+		if ( next != NULL ) {
+			for ( size_t offset = 0; offset < next->size(); offset += sizeof(LogRecord) + record.length ) {
+				memcpy(&record, next->data() + offset, sizeof(LogRecord));
+				format(&record, next->data() + offset + sizeof(LogRecord));
+			}
+			delete next;
+			if ( waiting > 0 ) {
+				lock_guard<mutex> guard(lock);
+				drained.notify_all();
+			}
+			continue;
+		}
 
-		strcat(stdstring2, DBG_LOG);
-		strcat(stdstring3, STATS_LOG);
+		for ( int file = 0; file < LOG_FILES; file++ ) {
+			writeOut(file);
+		}
+		if ( stopping ) {
+			if ( ring.empty() ) {
+				fflush(dbg);
+				fflush(stats);
+				if ( events ) {
+					fflush(events);
+				}
+				finished = true;
+				return;
+			}
+			continue;
+		}
 
-		fp = fopen(stdstring2, "w");
-		fp2 = fopen(stdstring3, "w");
+		unique_lock<mutex> guard(lock);
+		writerSleeping = true;
+		if ( ring.empty() && !stopping ) {
+			filled.wait_for(guard, chrono::milliseconds(50));
+		}
+		writerSleeping = false;
+	}
+}
 
-		dbg_opened=639;
+/**
+ * FUNCTION NAME: format
+ *
+ * DESCRIPTION: Add the line of a record to its file's output, after the
+ * 				magic number header of dbg.log if it has not been written
+ * 				yet. Event records are copied as they are.
+ */
+void Log::format(const LogRecord *record, const char *text) {
+	char prefix[64];
+	string &lines = out[record->file];
+
+	if ( record->file == LOG_EVENTS ) {
+		lines.append(text, record->length);
+	}
+	else {
+		if (!firstTime) {
+			snprintf(prefix, sizeof(prefix), "%x\n", EventLog::magicNumber());
+			out[LOG_DBG] += prefix;
+			firstTime = true;
+		}
+		EventLog::linePrefix(prefix, sizeof(prefix), record->addr, record->time);
+		lines += prefix;
+		lines.append(text, record->length);
 	}
-	else 
 
-	sprintf(stdstring, "%d.%d.%d.%d:%d ", addr->addr[0], addr->addr[1], addr->addr[2], addr->addr[3], *(short *)&addr->addr[4]);
+	if ( lines.size() >= LOG_WRITE_SIZE ) {
+		writeOut(record->file);
+	}
+}
 
-	va_start(vararglist, str);
-	vsprintf(buffer, str, vararglist);
-	va_end(vararglist);
+/**
+ * FUNCTION NAME: writeOut
+ *
+ * DESCRIPTION: Write the gathered output of one file in one go
+ */
+void Log::writeOut(int file) {
+	FILE *files[LOG_FILES] = { dbg, stats, events };
 
-	if (!firstTime) {
-		int magicNumber = 0;
-		string magic = MAGIC_NUMBER;
-		int len = magic.length();
-		for ( int i = 0; i < len; i++ ) {
-			magicNumber += (int)magic.at(i);
-		}
-		fprintf(fp, "%x\n", magicNumber);
-		firstTime = true;
+	if ( !out[file].empty() ) {
+		fwrite(out[file].data(), 1, out[file].size(), files[file]);
+		out[file].clear();
+	}
+}
+
+/**
+ * FUNCTION NAME: setBatch
+ *
+ * DESCRIPTION: Hold back the calling thread's log records in b until
+ * 				flushBatch, or log into its own chunk again if b is NULL
+ */
+void Log::setBatch(LogBatch *b) {
+	batch = b;
+}
+
+/**
+ * FUNCTION NAME: flushBatch
+ *
+ * DESCRIPTION: Log and empty a batch filled by another thread, after what
+ * 				the calling thread has logged so far
+ */
+void Log::flushBatch(LogBatch *b) {
+	if ( b->records.empty() ) {
+		return;
 	}
+	LogChunk &records = this->records();
+	chunk.appending = 1;
+	records.insert(records.end(), b->records.begin(), b->records.end());
+	chunk.appending = 0;
+	b->records.clear();
 
-	if(memcmp(buffer, "#STATSLOG#", 10)==0){
-		fprintf(fp2, "\n %s", stdstring);
-		fprintf(fp2, "[%d] ", par->getcurrtime());
+	if ( !batch && chunk.records->size() >= LOG_CHUNK_SIZE ) {
+		submit(chunk.records);
+		chunk.records = NULL;
+	}
+}
+
+/**
+ * FUNCTION NAME: flush
+ *
+ * DESCRIPTION: Queue the calling thread's chunk now, however full
+ */
+void Log::flush() {
+	if ( chunk.records != NULL && !chunk.records->empty() ) {
+		submit(chunk.records);
+	}
+	else {
+		delete chunk.records;
+	}
+	chunk.records = NULL;
+}
+
+/**
+ * FUNCTION NAME: close
+ *
+ * DESCRIPTION: Queue the calling thread's chunk, let the writer finish
+ * 				the ring, and close the files. Later calls do nothing.
+ */
+void Log::close() {
+	if ( closed ) {
+		return;
+	}
+	flush();
+	stopping = true;
+	{
+		lock_guard<mutex> guard(lock);
+		filled.notify_one();
+	}
+	writer.join();
 
-		fprintf(fp2, buffer);
+	fclose(dbg);
+	fclose(stats);
+	if ( events ) {
+		fclose(events);
+	}
+	closed = true;
+	if ( current == this ) {
+		current = NULL;
 	}
-	else{
-		fprintf(fp, "\n %s", stdstring);
-		fprintf(fp, "[%d] ", par->getcurrtime());
-		fprintf(fp, buffer);
+}
 
+/**
+ * FUNCTION NAME: closeCurrent
+ *
+ * DESCRIPTION: At exit, flush the Log the program did not delete
+ */
+void Log::closeCurrent() {
+	if ( current ) {
+		current->close();
 	}
+}
 
-	if(++numwrites >= MAXWRITES){
-		fflush(fp);
-		fflush(fp2);
-		numwrites=0;
+/**
+ * FUNCTION NAME: drainCurrent
+ *
+ * DESCRIPTION: On a fatal signal, queue the crashing thread's chunk if it
+ * 				was not in the middle of adding a record and the ring has
+ * 				room, let the writer thread write out the ring for up to
+ * 				LOG_DRAIN_MS, then raise the signal again with its default
+ * 				action. On the writer thread itself nothing is waited for.
+ * 				Nothing here allocates or takes a lock.
+ */
+void Log::drainCurrent(int sig) {
+	Log *log = current;
+
+	if ( log && !log->closed && !writerThread ) {
+		if ( chunk.log == log && chunk.records != NULL && !chunk.appending && log->ring.push(chunk.records) ) {
+			chunk.records = NULL;
+		}
+		log->stopping = true;
+		for ( int i = 0; i < LOG_DRAIN_MS && !log->finished; i++ ) {
+			usleep(1000);
+		}
 	}
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
 
+/**
+ * Destructor
+ * Queue the records of an exiting thread on the Log they were logged to,
+ * if it is still open
+ */
+ThreadChunk::~ThreadChunk() {
+	if ( records != NULL && !records->empty() && log == Log::current && !log->closed ) {
+		log->submit(records);
+	}
+	else {
+		delete records;
+	}
+	records = NULL;
 }
 
 /**
@@ -114,9 +372,7 @@ void Log::LOG(Address *addr, const char * str, ...) {
  * DESCRIPTION: To Log a node add
  */
 void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
-	static char stdstring[100];
-	sprintf(stdstring, "Node %d.%d.%d.%d:%d joined at time %d", addedAddr->addr[0], addedAddr->addr[1], addedAddr->addr[2], addedAddr->addr[3], *(short *)&addedAddr->addr[4], par->getcurrtime());
-    LOG(thisNode, stdstring);
+	logEvent(EVENT_JOIN, thisNode, addedAddr);
 }
 
 /**
@@ -125,7 +381,23 @@ void Log::logNodeAdd(Address *thisNode, Address *addedAddr) {
  * DESCRIPTION: To log a node remove
  */
 void Log::logNodeRemove(Address *thisNode, Address *removedAddr) {
-	static char stdstring[30];
-	sprintf(stdstring, "Node %d.%d.%d.%d:%d removed at time %d", removedAddr->addr[0], removedAddr->addr[1], removedAddr->addr[2], removedAddr->addr[3], *(short *)&removedAddr->addr[4], par->getcurrtime());
-    LOG(thisNode, stdstring);
+	logEvent(EVENT_REMOVE, thisNode, removedAddr);
+}
+
+/**
+ * FUNCTION NAME: logEvent
+ *
+ * DESCRIPTION: Log an eventTYPE seen by observer about subject: a record
+ * 				in events.bin with EVENT_LOG set, its dbg.log line otherwise
+ */
+void Log::logEvent(int type, Address *observer, Address *subject) {
+	EventRecord event = EventLog::make(type, observer->addr, subject->addr, par->getcurrtime());
+	char text[100];
+
+	if ( par->EVENT_LOG ) {
+		append(LOG_EVENTS, observer, (char *)&event, sizeof(event));
+	}
+	else {
+		append(LOG_DBG, observer, text, min(EventLog::describe(&event, text, sizeof(text)), (int)sizeof(text) - 1));
+	}
 }
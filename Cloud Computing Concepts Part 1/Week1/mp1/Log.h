@@ -10,33 +10,128 @@
 #include "stdincludes.h"
 #include "Params.h"
 #include "Member.h"
+#include "LogRing.h"
+#include "EventLog.h"
+#include "Trace.h"
 
 /*
  * Macros
  */
-// number of writes after which to flush file
-#define MAXWRITES 1
-#define MAGIC_NUMBER "CS425"
 #define DBG_LOG "dbg.log"
 #define STATS_LOG "stats.log"
+// chunks that may wait for the writer thread before loggers are held up
+#define LOG_RING_SLOTS 64
+// bytes of formatted lines the writer thread gathers per file before a write
+#define LOG_WRITE_SIZE (1024 * 1024)
+// ms a fatal signal waits for the writer thread to drain the ring
+#define LOG_DRAIN_MS 5000
+
+/**
+ * STRUCT NAME: LogBatch
+ *
+ * DESCRIPTION: Log records held back by a worker thread until the tick barrier
+ */
+typedef struct LogBatch {
+	LogChunk records;
+}LogBatch;
+
+/**
+ * STRUCT NAME: ThreadChunk
+ *
+ * DESCRIPTION: Records a thread logged outside a batch, and the Log they
+ * 				go to. They are queued on that Log when the thread exits.
+ */
+class Log;
+typedef struct ThreadChunk {
+	Log *log;
+	LogChunk *records;
+	// set while a record is being added, when records may be reallocating
+	volatile sig_atomic_t appending;
+	~ThreadChunk();
+}ThreadChunk;
 
 /**
  * CLASS NAME: Log
  *
- * DESCRIPTION: Functions to log messages in a debug log
+ * DESCRIPTION: Functions to log messages in a debug log.
+ *
+ * 				LOG only formats the message: the record, with the node's
+ * 				address and the time still binary, goes into the calling
+ * 				thread's chunk, and full chunks are queued on a LogRing. A
+ * 				writer thread formats the lines and writes each file in
+ * 				large blocks. The files get the same bytes, in the same
+ * 				order, as writing every line straight away.
+ *
+ * 				Memory is bounded by the ring: a thread that finds it full
+ * 				waits for the writer, so no line is ever dropped. A thread's
+ * 				chunk is queued when the thread exits, and the files are
+ * 				written and closed when the Log is deleted or the program
+ * 				exits. On a fatal signal or SIGINT/SIGTERM the ring is
+ * 				drained before the signal is raised again; the writer
+ * 				thread blocks SIGINT and SIGTERM so they land elsewhere. A
+ * 				crash can still lose what other threads held in their
+ * 				chunks or batches, or the record being added when it hit,
+ * 				so dbg.log is best-effort after one.
+ *
+ * 				Joins, removals, failures, leaves and restarts are lines of
+ * 				dbg.log, or with EVENT_LOG set 8-byte EventRecords in
+ * 				events.bin that EventConv turns back into those lines.
  */
 class Log{
 private:
 	Params *par;
 	bool firstTime;
+	FILE *dbg;
+	FILE *stats;
+	// events.bin, or NULL unless EVENT_LOG is set
+	FILE *events;
+	LogRing ring;
+	thread writer;
+	mutex lock;
+	// signalled when the ring gets a chunk for a sleeping writer, and when it frees a cell
+	condition_variable filled;
+	condition_variable drained;
+	atomic<bool> writerSleeping;
+	atomic<int> waiting;
+	atomic<bool> stopping;
+	bool closed;
+	// set by the writer thread once it has written out all it was given
+	atomic<bool> finished;
+	// formatted lines waiting to be written, per logFILE
+	string out[LOG_FILES];
+	// batch the calling thread logs into, or NULL to log into its own chunk
+	static thread_local LogBatch *batch;
+	static thread_local ThreadChunk chunk;
+	// set on the writer thread, which a fatal signal must not wait for
+	static thread_local bool writerThread;
+	// the Log flushed if the program exits without deleting it
+	static Log *current;
+	static void closeCurrent();
+	static void drainCurrent(int sig);
+	LogChunk &records();
+	void append(int file, Address *addr, const char *data, int length);
+	void submit(LogChunk *full);
+	void write();
+	void format(const LogRecord *record, const char *text);
+	void writeOut(int file);
 public:
 	Log(Params *p);
-	Log(const Log &anotherLog);
-	Log& operator = (const Log &anotherLog);
+	Log(const Log &anotherLog) = delete;
+	Log& operator = (const Log &anotherLog) = delete;
 	virtual ~Log();
 	void LOG(Address *, const char * str, ...);
+	// whether TRACE lines of level are logged in this run
+	bool accepts(int level) {
+		return level >= par->LOG_LEVEL;
+	}
 	void logNodeAdd(Address *, Address *);
 	void logNodeRemove(Address *, Address *);
+	void logEvent(int type, Address *observer, Address *subject);
+	void setBatch(LogBatch *b);
+	void flushBatch(LogBatch *b);
+	void flush();
+	void close();
+	friend struct ThreadChunk;
 };
 
 #endif /* _LOG_H_ */
@@ -0,0 +1,104 @@
+/**********************************
+ * FILE NAME: LogRing.cpp
+ *
+ * DESCRIPTION: Definition of the queue of log chunks
+ **********************************/
+
+#include "LogRing.h"
+
+/**
+ * Constructor
+ * slots is rounded up to a power of two
+ */
+LogRing::LogRing(size_t slots): tail(0), head(0) {
+	size_t size = 1;
+
+	while ( size < slots ) {
+		size <<= 1;
+	}
+	cells = new LogCell[size];
+	mask = size - 1;
+	for ( size_t i = 0; i < size; i++ ) {
+		cells[i].seq.store(i, memory_order_relaxed);
+		cells[i].chunk = NULL;
+	}
+}
+
+/**
+ * Destructor
+ * Chunks still queued are freed
+ */
+LogRing::~LogRing() {
+	LogChunk *chunk;
+
+	while ( (chunk = pop()) != NULL ) {
+		delete chunk;
+	}
+	delete[] cells;
+}
+
+/**
+ * FUNCTION NAME: push
+ *
+ * DESCRIPTION: Queue chunk. A cell is free for position pos when its
+ * 				sequence is pos, and holds the chunk of pos once it is
+ * 				pos + 1.
+ *
+ * RETURNS:
+ * false if the ring is full
+ */
+bool LogRing::push(LogChunk *chunk) {
+	size_t pos = tail.load(memory_order_relaxed);
+	LogCell *cell;
+
+	while ( true ) {
+		cell = &cells[pos & mask];
+		intptr_t diff = (intptr_t)cell->seq.load(memory_order_acquire) - (intptr_t)pos;
+		if ( diff == 0 ) {
+			if ( tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed) ) {
+				break;
+			}
+		}
+		else if ( diff < 0 ) {
+			return false;
+		}
+		else {
+			pos = tail.load(memory_order_relaxed);
+		}
+	}
+
+	cell->chunk = chunk;
+	cell->seq.store(pos + 1);
+	return true;
+}
+
+/**
+ * FUNCTION NAME: pop
+ *
+ * DESCRIPTION: Take the oldest chunk, and hand its cell to the producer one
+ * 				lap later. Only one thread may pop.
+ *
+ * RETURNS:
+ * the chunk, or NULL if the ring is empty
+ */
+LogChunk *LogRing::pop() {
+	LogCell *cell = &cells[head & mask];
+	LogChunk *chunk;
+
+	if ( cell->seq.load() != head + 1 ) {
+		return NULL;
+	}
+	chunk = cell->chunk;
+	cell->seq.store(head + mask + 1, memory_order_release);
+	head++;
+	return chunk;
+}
+
+/**
+ * FUNCTION NAME: empty
+ *
+ * DESCRIPTION: Whether pop would find nothing. Only the consumer may ask.
+ */
+bool LogRing::empty() {
+	return cells[head & mask].seq.load() != head + 1;
+}
@@ -0,0 +1,75 @@
+/**********************************
+ * FILE NAME: LogRing.h
+ *
+ * DESCRIPTION: Header file of the queue of log chunks between the threads
+ * 				that log and the thread that writes the log files
+ **********************************/
+
+#ifndef _LOGRING_H_
+#define _LOGRING_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// bytes of records a chunk is filled to before it is queued
+#define LOG_CHUNK_SIZE (64 * 1024)
+
+/**
+ * STRUCT NAME: LogRecord
+ *
+ * DESCRIPTION: Header of a binary log record, followed in its chunk by
+ * 				length bytes of message text. The address and time are
+ * 				formatted by the writer thread.
+ */
+typedef struct LogRecord {
+	// which log file, a logFILE
+	unsigned char file;
+	char addr[6];
+	int time;
+	unsigned int length;
+}LogRecord;
+
+// the files a record can go to
+enum logFILE { LOG_DBG, LOG_STATS, LOG_EVENTS, LOG_FILES };
+
+/**
+ * Type Name: LogChunk
+ *
+ * DESCRIPTION: Records logged by one thread, in order
+ */
+typedef vector<char> LogChunk;
+
+/**
+ * CLASS NAME: LogRing
+ *
+ * DESCRIPTION: Bounded lock-free queue of chunks with many producers and a
+ * 				single consumer. Each cell carries a sequence number that
+ * 				tells whose turn it is: producers claim a position by
+ * 				compare-and-swap on the tail, the consumer owns the head.
+ * 				push fails rather than wait when the ring is full, so the
+ * 				caller chooses how to apply backpressure.
+ */
+class LogRing {
+private:
+	typedef struct LogCell {
+		atomic<size_t> seq;
+		LogChunk *chunk;
+	}LogCell;
+	LogCell *cells;
+	size_t mask;
+	atomic<size_t> tail;
+	// only the consumer moves the head
+	size_t head;
+public:
+	LogRing(size_t slots);
+	LogRing(const LogRing &anotherRing) = delete;
+	LogRing& operator = (const LogRing &anotherRing) = delete;
+	virtual ~LogRing();
+	bool push(LogChunk *chunk);
+	LogChunk *pop();
+	bool empty();
+};
+
+#endif /* _LOGRING_H_ */
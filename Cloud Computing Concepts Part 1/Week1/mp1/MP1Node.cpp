@@ -16,16 +16,24 @@
    * You can add new members to the class if you think it
    * is necessary for your logic to work
    */
-MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Address *address) {
+MP1Node::MP1Node(Member *member, Params *params, EmulNet *emul, Log *log, Metrics *metrics, Address *address) {
 	for (int i = 0; i < 6; i++) {
 		NULLADDR[i] = 0;
 	}
 	this->memberNode = member;
 	this->emulNet = emul;
 	this->log = log;
+	this->metrics = metrics;
 	this->par = params;
 	this->memberNode->addr = *address;
-	this->lastEntry = NULL;
+	this->lastEntry = MemberHandle();
+	this->rng.seed(par->SEED, *(int *)(address->addr));
+	this->probeNext = 0;
+	this->probes = 0;
+	this->indirectProbes = 0;
+	this->indirectProbers = 0;
+	this->framesSent = 0;
+	memset(sentTypes, 0, sizeof(sentTypes));
 }
 
 /**
@@ -53,9 +61,9 @@ int MP1Node::recvLoop() {
  *
  * DESCRIPTION: Enqueue the message from Emulnet into the queue
  */
-int MP1Node::enqueueWrapper(void *env, char *buff, int size) {
+int MP1Node::enqueueWrapper(void *env, MsgView msg) {
 	Queue q;
-	return q.enqueue((queue<q_elt> *)env, (void *)buff, size);
+	return q.enqueue((queue<q_elt> *)env, std::move(msg));
 }
 
 /**
@@ -71,17 +79,13 @@ void MP1Node::nodeStart(char *servaddrstr, short servport) {
 
 	// Self booting routines
 	if (initThisNode(&joinaddr) == -1) {
-#ifdef DEBUGLOG
-		log->LOG(&memberNode->addr, "init_thisnode failed. Exit.");
-#endif
+		TRACE(TRACE_ERROR, log, &memberNode->addr, "init_thisnode failed. Exit.");
 		exit(1);
 	}
 
 	if (!introduceSelfToGroup(&joinaddr)) {
 		finishUpThisNode();
-#ifdef DEBUGLOG
-		log->LOG(&memberNode->addr, "Unable to join self to group. Exiting.");
-#endif
+		TRACE(TRACE_ERROR, log, &memberNode->addr, "Unable to join self to group. Exiting.");
 		exit(1);
 	}
 
@@ -108,15 +112,14 @@ int MP1Node::initThisNode(Address *joinaddr) {
 	// node is up!
 	memberNode->nnb = 0;
 	memberNode->heartbeat = 0;
-	memberNode->pingCounter = TFAIL;
-	memberNode->timeOutCounter = -1;
+	memberNode->nextPing = par->getcurrtime() + TFAIL;
+	memberNode->pingTimeout = -1;
 	initMemberListTable(memberNode);
 
 
 	// inite mypos, this is the first entry in the list
 	MemberListEntry entry = MemberListEntry(id, memberNode->addr.addr[4], memberNode->heartbeat, par->getcurrtime());
-	memberNode->memberList.push_back(entry);
-	memberNode->myPos = memberNode->memberList.begin();
+	memberNode->myPos = memberNode->memberList.insert(entry);
 	log->logNodeAdd(&memberNode->addr, &memberNode->addr);
 
 	return 0;
@@ -129,31 +132,25 @@ int MP1Node::initThisNode(Address *joinaddr) {
  */
 int MP1Node::introduceSelfToGroup(Address *joinaddr) {
 	MessageHdr *msg;
-#ifdef DEBUGLOG
-	static char s[1024];
-#endif
 
 	if (0 == memcmp((char *)&(memberNode->addr.addr), (char *)&(joinaddr->addr), sizeof(memberNode->addr.addr))) {
 		// I am the group booter (first process to join the group). Boot up the group
-#ifdef DEBUGLOG
-		log->LOG(&memberNode->addr, "Starting up group...");
-#endif
+		TRACE(TRACE_INFO, log, &memberNode->addr, "Starting up group...");
 		memberNode->inGroup = true;
 	}
 	else {
-		size_t msgsize = sizeof(MessageHdr) + sizeof(joinaddr->addr) + sizeof(long) + 1 + sizeof(int);
+		size_t msgsize = sizeof(MessageHdr) + sizeof(joinaddr->addr) + sizeof(long) + 1 + sizeof(int) + sizeof(unsigned int);
 		msg = (MessageHdr *)malloc(msgsize * sizeof(char));
 
-		// create JOINREQ message: format of data is {struct Address myaddr}
+		// create JOINREQ message: format of data is {struct Address myaddr, heartbeat, id, incarnation}
 		msg->msgType = JOINREQ;
 		memcpy((char *)(msg + 1), &memberNode->addr.addr, sizeof(memberNode->addr.addr));
 		memcpy((char *)(msg + 1) + 1 + sizeof(memberNode->addr.addr), &memberNode->heartbeat, sizeof(long));
 		memcpy((char *)(msg + 1) + 1 + sizeof(memberNode->addr.addr) + sizeof(long), &id, sizeof(int));
+		memcpy((char *)(msg + 1) + 1 + sizeof(memberNode->addr.addr) + sizeof(long) + sizeof(int),
+				&memberNode->memberList.get(memberNode->myPos)->incarnation, sizeof(unsigned int));
 
-#ifdef DEBUGLOG
-		sprintf(s, "Trying to join...\n");
-		log->LOG(&memberNode->addr, s);
-#endif
+		TRACE(TRACE_INFO, log, &memberNode->addr, "Trying to join...\n");
 
 		// send JOINREQ message to introducer member
 		emulNet->ENsend(&memberNode->addr, joinaddr, (char *)msg, msgsize);
@@ -165,15 +162,54 @@ int MP1Node::introduceSelfToGroup(Address *joinaddr) {
 
 }
 
+/**
+ * FUNCTION NAME: nodeRestart
+ *
+ * DESCRIPTION: Bring a failed node back through joinaddr. It starts over
+ * 				with what arrived while it was down thrown away, and an
+ * 				incarnation newer than any the group can hold for it, so
+ * 				its rejoin overrides its death.
+ */
+void MP1Node::nodeRestart(Address *joinaddr) {
+	MemberListEntry *self = memberNode->memberList.get(memberNode->myPos);
+	unsigned int incarnation = self != NULL ? self->incarnation + 1 : 0;
+
+	memberNode->bFailed = false;
+	recvLoop();
+	while (!memberNode->mp1q.empty()) {
+		memberNode->mp1q.pop();
+	}
+	gossip.clear();
+	frames.clear();
+	lastEntry = MemberHandle();
+
+	initThisNode(joinaddr);
+	memberNode->memberList.get(memberNode->myPos)->incarnation = incarnation;
+	queueGossip(id);
+	introduceSelfToGroup(joinaddr);
+}
+
 /**
  * FUNCTION NAME: finishUpThisNode
  *
- * DESCRIPTION: Wind up this node and clean up state
+ * DESCRIPTION: Wind up this node and clean up state. A node in the group
+ * 				leaves it: its entry is marked left, which its piggyback
+ * 				spreads, and a LEAVE goes out so members drop it at once
+ * 				instead of waiting for it to time out. It then stays down
+ * 				until restarted.
  */
 int MP1Node::finishUpThisNode() {
-	/*
-	 * Your code goes here
-	 */
+	if (memberNode->bFailed || !memberNode->inited) {
+		return true;
+	}
+
+	if (memberNode->inGroup) {
+		memberNode->memberList.get(memberNode->myPos)->status = MEMBER_LEFT;
+		sendLeave();
+		flushFrames();
+	}
+	memberNode->inGroup = false;
+	memberNode->bFailed = true;
 	return true;
 }
 
@@ -192,12 +228,13 @@ void MP1Node::nodeLoop() {
 	checkMessages();
 
 	// Wait until you're in the group...
-	if (!memberNode->inGroup) {
-		return;
+	if (memberNode->inGroup) {
+		// ...then jump in and share your responsibilites!
+		nodeLoopOps();
 	}
 
-	// ...then jump in and share your responsibilites!
-	nodeLoopOps();
+	// Send what this tick queued, one frame per destination
+	flushFrames();
 
 	return;
 }
@@ -208,15 +245,15 @@ void MP1Node::nodeLoop() {
  * DESCRIPTION: Check messages in the queue and call the respective message handler
  */
 void MP1Node::checkMessages() {
-	void *ptr;
-	int size;
-
 	// Pop waiting messages from memberNode's mp1q
 	while (!memberNode->mp1q.empty()) {
-		ptr = memberNode->mp1q.front().elt;
-		size = memberNode->mp1q.front().size;
+		// the message's storage is released when msg goes out of scope
+		MsgView msg = std::move(memberNode->mp1q.front().msg);
 		memberNode->mp1q.pop();
-		recvCallBack((void *)memberNode, (char *)ptr, size);
+		if (metrics != NULL && msg.getSize() >= (int)MSGTYPESIZE) {
+			metrics->countRecv(*(int *)msg.getData());
+		}
+		recvCallBack((void *)memberNode, msg.getData(), msg.getSize());
 	}
 	return;
 }
@@ -234,6 +271,12 @@ bool MP1Node::recvCallBack(void *env, char *data, int size) {
 	 //extract message type
 	MessageHdr* msg = (MessageHdr *)malloc(MSGTYPESIZE * sizeof(char));
 	memcpy(&msg->msgType, data, MSGTYPESIZE);
+
+	//a message sent on its own carries the piggyback after it
+	if (messageSize(msg->msgType) > 0 && (size_t)size > messageSize(msg->msgType)) {
+		processPiggyback(data, (unsigned int)messageSize(msg->msgType), size);
+	}
+
 	switch (msg->msgType) {
 
 	case(JOINREQ):
@@ -242,7 +285,7 @@ bool MP1Node::recvCallBack(void *env, char *data, int size) {
 
 	case(JOINREP):
 		//get ack from booster, online
-		joinrepHandler();
+		joinrepHandler(data, size);
 		break;
 	case(PING):
 		pingHandler(data);
@@ -262,15 +305,17 @@ bool MP1Node::recvCallBack(void *env, char *data, int size) {
 	case(SUBPINGACK):
 		subpingackHandler(data, size);
 		break;
+	case(FRAME):
+		frameHandler(data, size);
+		break;
+	case(LEAVE):
+		leaveHandler(data);
+		break;
 
 	case(DUMMYLASTMSGTYPE):
 	default:
 		//Unknown msgType
-#ifdef DEBUGLOG
-		static char s[1024];
-		sprintf(s, "error: Unknown msgType %d\n", msg->msgType);
-		log->LOG(&memberNode->addr, s);
-#endif
+		TRACE(TRACE_ERROR, log, &memberNode->addr, "error: Unknown msgType %d\n", msg->msgType);
 		return false;
 	}
 
@@ -278,18 +323,39 @@ bool MP1Node::recvCallBack(void *env, char *data, int size) {
 	return true;
 }
 
+/**
+* FUNCTION NAME: messageSize
+*
+* DESCRIPTION: Size of a probe message without its piggyback, 0 for the
+* 				other types
+*/
+size_t MP1Node::messageSize(enum MsgTypes type) {
+	switch (type) {
+	case(PING):
+	case(ACK):
+		return MSGTYPESIZE + ADDRARYSIZE + 1;
+	case(LEAVE):
+		return MSGTYPESIZE + ADDRARYSIZE + 1 + sizeof(unsigned int);
+	case(SUBPING):
+	case(SUBPINGREQ):
+	case(SUBPINGREP):
+	case(SUBPINGACK):
+		return MSGTYPESIZE + 2 * (ADDRARYSIZE + 1);
+	default:
+		return 0;
+	}
+}
+
 /**
 * FUNCTION NAME: joinHandler
 *
 * DESCRIPTION: Handle a new node join
 */
 bool MP1Node::joinHandler(char *data, int size) {
-#ifdef DEBUGLOG
-	static char s[1024];
-#endif
-	MemberListEntry* memberListEntry;
 	int id;
+	MemberListEntry *known;
 	long heartbeat;
+	unsigned int incarnation = 0;
 	MessageHdr* msg;
 
 	//get address
@@ -297,10 +363,7 @@ bool MP1Node::joinHandler(char *data, int size) {
 	memcpy(&addr->addr, data + MSGTYPESIZE, ADDRARYSIZE);
 
 	if (isNullAddress(addr)) {
-#ifdef DEBUGLOG
-		sprintf(s, "error: null message address.\n");
-		log->LOG(&memberNode->addr, s);
-#endif
+		TRACE(TRACE_ERROR, log, &memberNode->addr, "error: null message address.\n");
 		free(addr);
 		return false;
 	}
@@ -311,27 +374,46 @@ bool MP1Node::joinHandler(char *data, int size) {
 	//get id
 	memcpy(&id, data + MSGTYPESIZE + 1 + ADDRSIZE + sizeof(long), sizeof(int));
 
-#ifdef DEBUGLOG
-	sprintf(s, "Node id=%d was added to MemberListEntry.\n", id);
-	log->LOG(&memberNode->addr, s);
-#endif
+	//get incarnation, newer than the last one if the node restarted
+	if ((size_t)size >= MSGTYPESIZE + 1 + ADDRSIZE + sizeof(long) + sizeof(int) + sizeof(unsigned int)) {
+		memcpy(&incarnation, data + MSGTYPESIZE + 1 + ADDRSIZE + sizeof(long) + sizeof(int), sizeof(unsigned int));
+	}
 
-	memberListEntry = new MemberListEntry(id, addr->addr[4], heartbeat, par->getcurrtime());
-	memberNode->memberList.push_back(*memberListEntry);
-	memberNode->nnb++;//increment number of neighbors
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "Node id=%d was added to MemberListEntry.\n", id);
+
+	MemberHandle handle = memberNode->memberList.find(id);
+	known = memberNode->memberList.get(handle);
+	if (known == NULL) {
+		//the node itself asks, whatever was compacted about it
+		forgotten.erase(id);
+		MemberListEntry entry(id, addr->addr[4], heartbeat, par->getcurrtime());
+		entry.incarnation = incarnation;
+		markAlive(memberNode->memberList.insert(entry));
+		queueGossip(id);
+	}
+	else {
+		//a rejoin, refresh the existing entry and spread a new incarnation
+		known->heartbeat = heartbeat;
+		if (incarnation > known->incarnation) {
+			known->incarnation = incarnation;
+			queueGossip(id);
+		}
+		markAlive(handle);
+	}
 
-#ifdef DEBUGLOG
-	sprintf(s, "Node id=%d was added to group.\n", id);
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_INFO, log, &memberNode->addr, "Node id=%d was added to group.\n", id);
 	log->logNodeAdd(&memberNode->addr, addr);
+	removedAt.erase(id);
 
-	//sen JOINREP back
-	size_t msgsize = MSGTYPESIZE + 1;
+	//sen JOINREP back with as much of the member list as fits
+	size_t capacity = par->MAX_MSG_SIZE - sizeof(en_msg) - MSGTYPESIZE - 1 - 1;
+	capacity = min(capacity, MemberCodec::maxSize(memberNode->memberList.size()));
+	size_t msgsize = MSGTYPESIZE + 1 + capacity;
 	msg = (MessageHdr *)malloc(msgsize * sizeof(char));
 
-	// create JOINREP message: format of data is {struct Address myaddr}
+	// create JOINREP message: format of data is {member list}
 	msg->msgType = JOINREP;
+	msgsize = MSGTYPESIZE + 1 + fillMemberList((char *)msg, (unsigned int)MSGTYPESIZE + 1, capacity);
 
 	// send JOINREP message to put member online
 	emulNet->ENsend(&memberNode->addr, addr, (char *)msg, msgsize);
@@ -346,14 +428,12 @@ bool MP1Node::joinHandler(char *data, int size) {
 *
 * DESCRIPTION: Put this node online and initiate counter and member list
 */
-void MP1Node::joinrepHandler() {
+void MP1Node::joinrepHandler(char *data, int size) {
 	memberNode->inGroup = true;
+	//learn the group from the introducer's member list
+	processPiggyback(data, (unsigned int)MSGTYPESIZE + 1, size);
 	//this node is already in the list
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "Node id=%d is online with heartbeat=%ld, timestamp=%ld.\n", this->id, memberNode->myPos->heartbeat, memberNode->myPos->timestamp);
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "Node id=%d is online with heartbeat=%ld, timestamp=%ld.\n", this->id, memberNode->memberList.get(memberNode->myPos)->heartbeat, memberNode->memberList.get(memberNode->myPos)->timestamp);
 
 	//start counting
 	initCounter();
@@ -369,22 +449,12 @@ void MP1Node::joinrepHandler() {
 */
 void MP1Node::pingHandler(char *data){
 
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "PingHandler.\n");
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "PingHandler.\n");
 	//get address
 	Address* addr = (Address *)malloc(ADDRSIZE * sizeof(char));
 	memcpy(&addr->addr, data + MSGTYPESIZE, ADDRARYSIZE);
 
-#ifdef DEBUGLOG
-	sprintf(s, "Get PING from %s.\n", addr->getAddress().c_str());
-	log->LOG(&memberNode->addr, s);
-#endif
-
-	//update member list entry
-	processPiggyback(data, (unsigned int) MSGTYPESIZE + ADDRARYSIZE + 1 );
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "Get PING from %s.\n", addr->getAddress().c_str());
 
 	//send Ack back
 	sendACK(addr);
@@ -397,24 +467,14 @@ void MP1Node::pingHandler(char *data){
 * DESCRIPTION: process subping message
 */
 void MP1Node::subpingHandler(char *data, size_t size) {
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "SubpingHandler.\n");
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "SubpingHandler.\n");
 	//get address
 	Address* srcaddr = (Address *)malloc(ADDRSIZE * sizeof(char));
 	memcpy(&srcaddr->addr, data + MSGTYPESIZE, ADDRARYSIZE);
 	Address* destaddr = (Address *)malloc(ADDRSIZE * sizeof(char));
 	memcpy(&destaddr->addr, data + MSGTYPESIZE + ADDRARYSIZE + 1, ADDRARYSIZE);
 
-#ifdef DEBUGLOG
-	sprintf(s, "Get Subping from %s.\n", srcaddr->getAddress().c_str());
-	log->LOG(&memberNode->addr, s);
-#endif
-
-	//update member list entry
-	processPiggyback(data, (unsigned int)MSGTYPESIZE + 2*(ADDRARYSIZE + 1));
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "Get Subping from %s.\n", srcaddr->getAddress().c_str());
 
 	//send sendSubpingreq back
 	sendSubpingreq(srcaddr, destaddr);
@@ -428,24 +488,14 @@ void MP1Node::subpingHandler(char *data, size_t size) {
 * DESCRIPTION: process subping message
 */
 void MP1Node::subpingreqHandler(char *data, size_t size) {
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "subpingreqHandler.\n");
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "subpingreqHandler.\n");
 	//get address
 	Address* srcaddr = (Address *)malloc(ADDRSIZE * sizeof(char));
 	memcpy(&srcaddr->addr, data + MSGTYPESIZE, ADDRARYSIZE);
 	Address* midaddr = (Address *)malloc(ADDRSIZE * sizeof(char));
 	memcpy(&midaddr->addr, data + MSGTYPESIZE + ADDRARYSIZE + 1, ADDRARYSIZE);
 
-#ifdef DEBUGLOG
-	sprintf(s, "Get subpingreq from %s.\n", srcaddr->getAddress().c_str());
-	log->LOG(&memberNode->addr, s);
-#endif
-
-	//update member list entry
-	processPiggyback(data, (unsigned int)MSGTYPESIZE + 2 * (ADDRARYSIZE + 1));
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "Get subpingreq from %s.\n", srcaddr->getAddress().c_str());
 
 	//send sendSubpingreq back
 	sendSubpingrep(srcaddr, midaddr);
@@ -459,24 +509,14 @@ void MP1Node::subpingreqHandler(char *data, size_t size) {
 * DESCRIPTION: process subping message
 */
 void MP1Node::subpingrepHandler(char *data, size_t size) {
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "subpingrepHandler.\n");
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "subpingrepHandler.\n");
 	//get address
 	Address* srcaddr = (Address *)malloc(ADDRSIZE * sizeof(char));
 	memcpy(&srcaddr->addr, data + MSGTYPESIZE, ADDRARYSIZE);
 	Address* midaddr = (Address *)malloc(ADDRSIZE * sizeof(char));
 	memcpy(&midaddr->addr, data + MSGTYPESIZE + ADDRARYSIZE + 1, ADDRARYSIZE);
 
-#ifdef DEBUGLOG
-	sprintf(s, "Get subpingrep from %s.\n", srcaddr->getAddress().c_str());
-	log->LOG(&memberNode->addr, s);
-#endif
-
-	//update member list entry
-	processPiggyback(data, (unsigned int)MSGTYPESIZE + 2 * (ADDRARYSIZE + 1));
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "Get subpingrep from %s.\n", srcaddr->getAddress().c_str());
 
 	//send sendSubpingreq back
 	sendSubpingack(srcaddr, midaddr);
@@ -491,40 +531,25 @@ void MP1Node::subpingrepHandler(char *data, size_t size) {
 */
 void MP1Node::subpingackHandler(char *data, size_t size) {
 
-#ifdef DEBUGLOG
-	static char s[512];
-	sprintf(s, "ackHandler with size=%lu.\n", size);
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "ackHandler with size=%lu.\n", size);
 
 	//get address
 	Address* addr = (Address *)malloc(ADDRSIZE * sizeof(char));
 	memcpy(&addr->addr, data + MSGTYPESIZE, ADDRARYSIZE);
 
-#ifdef DEBUGLOG
-	sprintf(s, "Assigned addr.\n");
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "Assigned addr.\n");
 
 	memcpy(&addr->addr, data + MSGTYPESIZE, ADDRARYSIZE);
 
-#ifdef DEBUGLOG
-	sprintf(s, "SUBPINGACK was received from %s.\n", addr->getAddress().c_str());
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "SUBPINGACK was received from %s.\n", addr->getAddress().c_str());
 
 	//an ack back and remove lastentry
-	if (*(int *)addr->addr == lastEntry->getid()) {
-		lastEntry = NULL;
-#ifdef DEBUGLOG
-		static char s[1024];
-		sprintf(s, "Remove lastEntry.\n");
-		log->LOG(&memberNode->addr, s);
-#endif
+	MemberListEntry *probed = memberNode->memberList.get(lastEntry);
+	if (probed != NULL && *(int *)addr->addr == probed->getid()) {
+		lastEntry = MemberHandle();
+		TRACE(TRACE_DEBUG, log, &memberNode->addr, "Remove lastEntry.\n");
 	}
 
-	//update member list entry
-	processPiggyback(data, (unsigned int)MSGTYPESIZE + 2*(ADDRARYSIZE + 1));
 	free(addr);
 }
 
@@ -536,92 +561,210 @@ void MP1Node::subpingackHandler(char *data, size_t size) {
 */
 void MP1Node::ackHandler(char *data, int size) {
 
-#ifdef DEBUGLOG
-	static char s[512];
-	sprintf(s, "ackHandler with size=%d.\n", size);
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "ackHandler with size=%d.\n", size);
 
 	//get address
 	Address* addr = (Address *)malloc(ADDRSIZE * sizeof(char));
 	memcpy(&addr->addr, data + MSGTYPESIZE, ADDRARYSIZE);
 
-#ifdef DEBUGLOG
-	sprintf(s, "Assigned addr.\n");
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "Assigned addr.\n");
 
 	memcpy(&addr->addr, data + MSGTYPESIZE, ADDRARYSIZE);
 
-#ifdef DEBUGLOG
-	sprintf(s, "ACK was received from %s.\n", addr->getAddress().c_str());
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "ACK was received from %s.\n", addr->getAddress().c_str());
 
 	//an ack back and remove lastentry
-	if (*(int *)addr->addr == lastEntry->getid()) {
-		lastEntry = NULL;
-		//set timeoutcounter to -1
-		memberNode->timeOutCounter = -1;//set to nagative to avoid counter 0 again
-#ifdef DEBUGLOG
-		static char s[1024];
-		sprintf(s, "Remove lastEntry.\n");
-		log->LOG(&memberNode->addr, s);
-#endif
+	MemberListEntry *probed = memberNode->memberList.get(lastEntry);
+	if (probed != NULL && *(int *)addr->addr == probed->getid()) {
+		lastEntry = MemberHandle();
+		//no indirect probe needed
+		memberNode->pingTimeout = -1;
+		TRACE(TRACE_DEBUG, log, &memberNode->addr, "Remove lastEntry.\n");
 	}
 
-	//update member list entry
-	processPiggyback(data, (unsigned int) MSGTYPESIZE + ADDRARYSIZE + 1);
 	free(addr);
 }
 
+/**
+* FUNCTION NAME: frameHandler
+*
+* DESCRIPTION: process a frame: learn from its shared piggyback first, then
+* 				hand each message in it to recvCallBack
+*/
+void MP1Node::frameHandler(char *data, int size) {
+	unsigned char count = (unsigned char)data[MSGTYPESIZE];
+	unsigned int offset = FRAMEHDRSIZE;
+	unsigned short length;
+
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "frameHandler with %u messages.\n", count);
+
+	//the piggyback follows the last message
+	for (unsigned char i = 0; i < count; i++) {
+		if (offset + FRAMELENSIZE > (unsigned int)size) {
+			TRACE(TRACE_ERROR, log, &memberNode->addr, "Dropped a frame cut short at message %u.\n", i);
+			return;
+		}
+		memcpy(&length, data + offset, FRAMELENSIZE);
+		offset += FRAMELENSIZE + length;
+	}
+	if (offset > (unsigned int)size) {
+		TRACE(TRACE_ERROR, log, &memberNode->addr, "Dropped a frame cut short in its last message.\n");
+		return;
+	}
+	processPiggyback(data, offset, size);
+
+	offset = FRAMEHDRSIZE;
+	for (unsigned char i = 0; i < count; i++) {
+		memcpy(&length, data + offset, FRAMELENSIZE);
+		offset += FRAMELENSIZE;
+		recvCallBack((void *)memberNode, data + offset, length);
+		offset += length;
+	}
+}
+
+/**
+* FUNCTION NAME: leaveHandler
+*
+* DESCRIPTION: process a leave message: the sender is removed now, and
+* 				the change is gossiped on
+*/
+void MP1Node::leaveHandler(char *data) {
+	MemberListEntry entry;
+
+	memcpy(&entry.id, data + MSGTYPESIZE, sizeof(int));
+	memcpy(&entry.port, data + MSGTYPESIZE + sizeof(int), sizeof(short));
+	memcpy(&entry.incarnation, data + MSGTYPESIZE + ADDRARYSIZE + 1, sizeof(unsigned int));
+	entry.status = MEMBER_LEFT;
+
+	TRACE(TRACE_INFO, log, &memberNode->addr, "LEAVE was received from %d.\n", entry.id);
+
+	//usually the piggyback has already told us
+	updateMemberList(&entry);
+}
 
 /**
 * FUNCTION NAME: processPiggyback
 *
-* DESCRIPTION: given message and offset, update member entry
+* DESCRIPTION: given message, offset and the message size, decode the piggybacked
+* 				entries and update member entry. Entries before a cut short or
+* 				corrupt one are kept, the rest are dropped.
 */
-void MP1Node::processPiggyback(char *msg, unsigned int offset) {
-	size_t size;
-	memcpy(&size, msg + offset, sizeof(size_t));
-
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "Message received is %lu.\n", MSGTYPESIZE);
-	log->LOG(&memberNode->addr, s);
-	sprintf(s, "ProcessPiggyback with %lu entrys.\n",size);
-	log->LOG(&memberNode->addr, s);
-#endif
-
-	MemberListEntry* entry = (MemberListEntry*) malloc(sizeof(MemberListEntry) * sizeof(char));
-	for (int counter = 0; size > 0; size--, counter++) {
-		memcpy(entry, msg + offset + sizeof(size_t) + counter * sizeof(MemberListEntry), sizeof(MemberListEntry));
+void MP1Node::processPiggyback(char *msg, unsigned int offset, int msgsize) {
+	unsigned short size;
+	long base;
+	const char *end = msg + msgsize;
+	const char *next = MemberCodec::decodeHeader(msg + offset, end, &size, &base);
+
+	if (next == NULL) {
+		TRACE(TRACE_ERROR, log, &memberNode->addr, "Dropped a piggyback cut short in its header.\n");
+		return;
+	}
+
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "Message received is %lu.\n", MSGTYPESIZE);
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "ProcessPiggyback with %u entrys.\n", size);
+
+	MemberListEntry entry;
+	for (; size > 0; size--) {
+		next = MemberCodec::decodeEntry(next, end, &entry, base);
+		if (next == NULL) {
+			TRACE(TRACE_ERROR, log, &memberNode->addr, "Dropped %u piggybacked entries past the end of the message.\n", size);
+			return;
+		}
 		//process entry
-		updateMemberList(entry);
+		updateMemberList(&entry);
 	}
-	free(entry);
 }
 
 
+/**
+* FUNCTION NAME: queueGossip
+*
+* DESCRIPTION: Queue a change to the entry of member id for dissemination
+*/
+void MP1Node::queueGossip(int id) {
+	for (unsigned int i = 0; i < gossip.size(); i++) {
+		if (gossip[i].id == id) {
+			//already queued, start its count over
+			gossip[i].sent = 0;
+			return;
+		}
+	}
+	GossipEntry entry = { id, 0 };
+	gossip.push_back(entry);
+}
+
+/**
+* FUNCTION NAME: piggybackSize
+*
+* DESCRIPTION: Upper bound on the bytes fillPiggyback will write: my own entry
+* 				plus the queued changes, capped at PIGGYBACK_MAX entries
+*/
+size_t MP1Node::piggybackSize() {
+	return MemberCodec::maxSize(min((size_t)par->PIGGYBACK_MAX, gossip.size() + 1));
+}
+
 /**
 * FUNCTION NAME: fillPiggyback
 *
-* DESCRIPTION: Take the pointer of message and offset to fill all memberlistentry
+* DESCRIPTION: Take the pointer of message and offset to encode my own entry and
+* 				the changes piggybacked the fewest times so far. A change is
+* 				dropped once it has been sent PIGGYBACK_LAMBDA*log2(n+1) times.
+* 				Returns the number of bytes written.
 */
-void MP1Node::fillPiggyback(char *msg, unsigned int  offset) {
-	size_t size = (size_t)memberNode->memberList.size();
-	memcpy(msg + offset, &size, sizeof(size_t));
+size_t MP1Node::fillPiggyback(char *msg, unsigned int  offset) {
+	unsigned short size = min((size_t)par->PIGGYBACK_MAX, gossip.size() + 1);
+	int limit = max(1, par->PIGGYBACK_LAMBDA * (int)ceil(log2(memberNode->memberList.size() + 1)));
+	MemberListEntry *self = memberNode->memberList.get(memberNode->myPos);
+	long base = self->heartbeat;
+
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "Filled %u entries in piggyback.\n", size);
+	if (metrics != NULL) {
+		metrics->countPiggyback(size);
+	}
 
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "Filled %lu entries in piggyback.\n", size);
-	log->LOG(&memberNode->addr, s);
-#endif
+	//the deltas are taken from the lowest heartbeat sent
+	stable_sort(gossip.begin(), gossip.end(), [](const GossipEntry &a, const GossipEntry &b) { return a.sent < b.sent; });
+	for (size_t i = 0; i + 1 < size; i++) {
+		base = min(base, memberNode->memberList.get(memberNode->memberList.find(gossip[i].id))->heartbeat);
+	}
+
+	char *entry = MemberCodec::encodeHeader(msg + offset, size, base);
+	entry = MemberCodec::encodeEntry(entry, self, base);
+	for (size_t i = 0; i + 1 < size; i++) {
+		entry = MemberCodec::encodeEntry(entry, memberNode->memberList.get(memberNode->memberList.find(gossip[i].id)), base);
+		gossip[i].sent++;
+	}
+
+	gossip.erase(remove_if(gossip.begin(), gossip.end(), [limit](const GossipEntry &g) { return g.sent >= limit; }), gossip.end());
+	return entry - (msg + offset);
+}
+
+/**
+* FUNCTION NAME: fillMemberList
+*
+* DESCRIPTION: Take the pointer of message and offset to encode as many entries
+* 				of the member list as fit in capacity bytes. Returns the number
+* 				of bytes written.
+*/
+size_t MP1Node::fillMemberList(char *msg, unsigned int offset, size_t capacity) {
+	unsigned short count = 0;
+	char *end = msg + offset + capacity;
+	long base = memberNode->heartbeat;
+
+	//the deltas are taken from the lowest heartbeat in the list
+	for (auto list = memberNode->memberList.begin(); list != memberNode->memberList.end(); list++) {
+		base = min(base, list->heartbeat);
+	}
+	char *entry = MemberCodec::encodeHeader(msg + offset, count, base);
 
 	auto list = memberNode->memberList.begin();
-	for (int i = 0; list != memberNode->memberList.end(); list++, i++) {
-		memcpy(msg + offset + sizeof(size_t) + i * sizeof(MemberListEntry), &(*list), sizeof(MemberListEntry));
+	for (; list != memberNode->memberList.end() && entry + CODEC_ENTRY_MAX <= end; list++, count++) {
+		entry = MemberCodec::encodeEntry(entry, &(*list), base);
 	}
+
+	//the count is fixed width, patch it now that it is known
+	MemberCodec::encodeHeader(msg + offset, count, base);
+	return entry - (msg + offset);
 }
 
 /**
@@ -630,37 +773,114 @@ void MP1Node::fillPiggyback(char *msg, unsigned int  offset) {
 * DESCRIPTION: Given a entry, check heart beat and update, if not exist, add this entry
 */
 void MP1Node::updateMemberList(MemberListEntry* entry) {
-	vector<MemberListEntry>::iterator it = memberNode->memberList.begin();
+	MemberHandle handle = memberNode->memberList.find(entry->id);
+	MemberListEntry *it = memberNode->memberList.get(handle);
+
+	//news about me: refute a suspicion or death by moving to a newer incarnation
+	if (handle == memberNode->myPos) {
+		if (entry->status != MEMBER_ALIVE && entry->incarnation >= it->incarnation) {
+			it->incarnation = entry->incarnation + 1;
+			queueGossip(it->id);
+		}
+		return;
+	}
 
 	//if in the list, update status
-	for (; it != memberNode->memberList.end(); it++) {
-		if (it->id == entry->id) {
-			//exist in the list
-			if (it->heartbeat < entry->getheartbeat()) {
-				//it is a newer one
-				it->heartbeat = entry->getheartbeat();
-				if (entry->timestamp < 0 && it->timestamp > 0) {
-					//a new failed entry was noticed
-					logRemoveEntry(entry);
-					it->timestamp = entry->timestamp;
-				}
-				else {
-					it->timestamp = par->globaltime;
+	if (it != NULL) {
+		it->heartbeat = max(it->heartbeat, entry->heartbeat);
+		if (overrides(entry, it)) {
+			it->incarnation = entry->incarnation;
+			if (entry->status == MEMBER_DEAD) {
+				//a new failed entry was noticed
+				logRemoveEntry(it);
+				markFailed(handle);
+			}
+			else if (entry->status == MEMBER_LEFT) {
+				logLeftEntry(it);
+				markFailed(handle, MEMBER_LEFT);
+			}
+			else if (entry->status == MEMBER_SUSPECT) {
+				markSuspect(handle);
+			}
+			else {
+				//back from the dead: it refuted its death or rejoined
+				if (it->status == MEMBER_DEAD || it->status == MEMBER_LEFT) {
+					Address entryAddr = getListEntryAddr(it);
+					log->logNodeAdd(&memberNode->addr, &entryAddr);
+					removedAt.erase(entry->id);
 				}
+				markAlive(handle);
 			}
-			//there is a match
-			entry->setheartbeat(-1);
+			queueGossip(entry->id);
 		}
 	}
-
 	//not in the list
-	if (entry->getheartbeat() != -1L) {
+	else {
+		map<int, unsigned int>::iterator gone = forgotten.find(entry->id);
+		if (gone != forgotten.end()) {
+			//stale news about a compacted member
+			if (entry->incarnation <= gone->second) {
+				return;
+			}
+			forgotten.erase(gone);
+		}
 		Address entryAddr;
 		*(int *)(&entryAddr.addr) = entry->id;
 		*(short *)(&entryAddr.addr[4]) = entry->port;
 		log->logNodeAdd(&memberNode->addr, &entryAddr);//log new node
-		memberNode->memberList.push_back(MemberListEntry(*entry));
-		if (entry->timestamp >= 0)memberNode->nnb++;//this is a live node
+		removedAt.erase(entry->id);
+		entry->timestamp = par->globaltime;
+		handle = memberNode->memberList.insert(*entry);
+		if (entry->status == MEMBER_ALIVE || entry->status == MEMBER_SUSPECT) {
+			markAlive(handle);
+		}
+		if (entry->status == MEMBER_SUSPECT) {
+			markSuspect(handle);
+		}
+		queueGossip(entry->id);
+	}
+}
+
+/**
+* FUNCTION NAME: overrides
+*
+* DESCRIPTION: Whether an update about a member supersedes what is known.
+* 				Alive needs a newer incarnation; suspect wins over alive of
+* 				the same incarnation; dead or left wins over alive or
+* 				suspect of the same or an older incarnation.
+*/
+bool MP1Node::overrides(MemberListEntry *update, MemberListEntry *known) {
+	switch (update->status) {
+	case MEMBER_DEAD:
+	case MEMBER_LEFT:
+		return known->status != MEMBER_DEAD && known->status != MEMBER_LEFT && update->incarnation >= known->incarnation;
+	case MEMBER_SUSPECT:
+		return known->status == MEMBER_ALIVE ? update->incarnation >= known->incarnation : update->incarnation > known->incarnation;
+	default:
+		return update->incarnation > known->incarnation;
+	}
+}
+
+/**
+* FUNCTION NAME: checkSuspects
+*
+* DESCRIPTION: Declare dead the suspects that were not refuted within
+* 				SUSPECT_TIMEOUT ticks
+*/
+void MP1Node::checkSuspects() {
+	for (unsigned int i = 0; i < suspects.size(); ) {
+		MemberListEntry *entry = memberNode->memberList.get(suspects[i]);
+		if (entry != NULL && entry->status == MEMBER_SUSPECT && par->globaltime - entry->timestamp < par->SUSPECT_TIMEOUT) {
+			i++;
+			continue;
+		}
+		if (entry != NULL && entry->status == MEMBER_SUSPECT) {
+			logRemoveEntry(entry);
+			markFailed(suspects[i]);
+			queueGossip(entry->id);
+		}
+		suspects[i] = suspects.back();
+		suspects.pop_back();
 	}
 }
 
@@ -676,23 +896,15 @@ void MP1Node::nodeLoopOps() {
 	/*
 	 * Your code goes here
 	 */
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "Enter nodeLoopOps().\n");
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "Enter nodeLoopOps().\n");
 
 	//update new heartbeat
 	updateStatus();
 
-#ifdef DEBUGLOG
-	sprintf(s, "My heartbeat goes to %ld.\n", memberNode->heartbeat);
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "My heartbeat goes to %ld.\n", memberNode->heartbeat);
 
-	//counter goes down
-	countDownCounter();
 	checkCounter();
+	checkSuspects();
 
 	return;
 }
@@ -700,46 +912,37 @@ void MP1Node::nodeLoopOps() {
 /**
 * FUNCTION NAME: checkCounter
 *
-* DESCRIPTION: check the counter to decide the next step
+* DESCRIPTION: check the ping deadlines to decide the next step
 */
 void MP1Node::checkCounter() {
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "checkCounter.\n");
-	log->LOG(&memberNode->addr, s);
-#endif
-	if (memberNode->pingCounter == 0) {
-#ifdef DEBUGLOG
-		sprintf(s, "Pingcounter reaches 0.\n");
-		log->LOG(&memberNode->addr, s);
-#endif
-		//remove last
-		if (lastEntry != NULL) {
-#ifdef DEBUGLOG
-			sprintf(s, "Enter remove last entry.\n");
-			log->LOG(&memberNode->addr, s);
-#endif
-			logRemoveEntry();
-			lastEntry->timestamp = -1;//set as failed node
-			lastEntry = NULL;
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "checkCounter.\n");
+	if (par->getcurrtime() >= memberNode->nextPing) {
+		TRACE(TRACE_DEBUG, log, &memberNode->addr, "Ping period is over.\n");
+		//no ack directly or through the probers, suspect the last probed
+		MemberListEntry *probed = memberNode->memberList.get(lastEntry);
+		if (probed != NULL) {
+			if (probed->status == MEMBER_ALIVE) {
+				TRACE(TRACE_INFO, log, &memberNode->addr, "Suspect last entry.\n");
+				markSuspect(lastEntry);
+				queueGossip(probed->id);
+			}
+			lastEntry = MemberHandle();
 		}
 
-		//reset pingcounter and timeout counter
+		//start the next ping period, dropping entries that are long gone
+		compactMemberList();
 		initCounter();
 		//prepare ping message and send
 		sendPing();
 	}
 
-	if (memberNode->timeOutCounter == 0) {
-#ifdef DEBUGLOG
-		sprintf(s, "timeOutCounter reaches 0.");
-		log->LOG(&memberNode->addr, s);
-#endif
+	if (memberNode->pingTimeout >= 0 && par->getcurrtime() >= memberNode->pingTimeout) {
+		TRACE(TRACE_DEBUG, log, &memberNode->addr, "Ping timed out.");
 		//prepare subping message
 		sendSubping();
 
-		//set timeoutcounter to -1
-		memberNode->timeOutCounter = -1;//set to nagative to avoid counter 0 again
+		//no more indirect probes this period
+		memberNode->pingTimeout = -1;
 	}
 
 }
@@ -751,42 +954,30 @@ void MP1Node::checkCounter() {
 */
 void MP1Node::sendPing() {
 
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "sendPing.\n");
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "sendPing.\n");
 
 	//check if aviliable neighbor to send ping
 	if (memberNode->nnb > 0) {
-		size_t msgsize = MSGTYPESIZE + ADDRARYSIZE + 1 + sizeof(size_t) + sizeof(MemberListEntry) * memberNode->memberList.size();
+		size_t msgsize = MSGTYPESIZE + ADDRARYSIZE + 1;
 		MessageHdr* msg = (MessageHdr *)malloc(msgsize * sizeof(char));
 
 		msg->msgType = PING;
 		memcpy((char *)msg + MSGTYPESIZE, &memberNode->addr.addr, ADDRARYSIZE);
 
-		//fill payload
-		fillPiggyback((char *)msg, (unsigned int)MSGTYPESIZE + ADDRARYSIZE + 1);
+		//select the next live neighbor in the probe order
+		Address toAddr = getNextNeighbor();
 
-		//select a random live neighbor
-		Address toAddr = getRandomNeighbor();
-
-#ifdef DEBUGLOG
-		sprintf(s, "Ping send from %s to %s.\n", memberNode->addr.getAddress().c_str(), toAddr.getAddress().c_str());
-		log->LOG(&memberNode->addr, s);
-#endif
+		TRACE(TRACE_DEBUG, log, &memberNode->addr, "Ping send from %s to %s.\n", memberNode->addr.getAddress().c_str(), toAddr.getAddress().c_str());
 
 		// send PING message to detect member
-		emulNet->ENsend(&memberNode->addr, &toAddr, (char *)msg, msgsize);
+		queueMessage(&toAddr, (char *)msg, msgsize);
+		probes++;
 
 		free(msg);
 	}
 	else {
-#ifdef DEBUGLOG
-		sprintf(s, "No neighbor aviliable.\n");
-		log->LOG(&memberNode->addr, s);
-#endif
-		memberNode->timeOutCounter = -1;
+		TRACE(TRACE_DEBUG, log, &memberNode->addr, "No neighbor aviliable.\n");
+		memberNode->pingTimeout = -1;
 	}
 
 }
@@ -799,23 +990,16 @@ void MP1Node::sendPing() {
 void MP1Node::sendACK(Address* addr) {
 	updateStatus();
 
-	size_t msgsize = MSGTYPESIZE + ADDRARYSIZE + 1 + sizeof(size_t) + sizeof(MemberListEntry) * memberNode->memberList.size();
+	size_t msgsize = MSGTYPESIZE + ADDRARYSIZE + 1;
 	MessageHdr* msg = (MessageHdr *)malloc(msgsize * sizeof(char));
 
 	msg->msgType = ACK;
 	memcpy((char *)msg + MSGTYPESIZE, &memberNode->addr.addr, ADDRARYSIZE);
 
-	//fill payload
-	fillPiggyback((char *)msg, (unsigned int)(MSGTYPESIZE + ADDRARYSIZE + 1));
-
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "ACK send from %s to %s.\n", memberNode->addr.getAddress().c_str(),addr->getAddress().c_str());
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "ACK send from %s to %s.\n", memberNode->addr.getAddress().c_str(),addr->getAddress().c_str());
 
 	// send PING message to detect member
-	emulNet->ENsend(&memberNode->addr, addr, (char *)msg, msgsize);
+	queueMessage(addr, (char *)msg, msgsize);
 
 	free(msg);
 }
@@ -827,49 +1011,36 @@ void MP1Node::sendACK(Address* addr) {
 */
 void MP1Node::sendSubping() {
 
-#ifdef DEBUGLOG
-	static char s[1024];
-#endif
+	MemberListEntry *probed = memberNode->memberList.get(lastEntry);
 
 	//check if more aviliable neighbor to send ping
-	if (memberNode->nnb > 1) {
+	if (memberNode->nnb > 1 && probed != NULL) {
 		//prepare message
-		size_t msgsize = MSGTYPESIZE + 2 * (ADDRARYSIZE + 1) + sizeof(size_t) + sizeof(MemberListEntry) * memberNode->memberList.size();
+		size_t msgsize = MSGTYPESIZE + 2 * (ADDRARYSIZE + 1);
 		MessageHdr* msg = (MessageHdr *)malloc(msgsize * sizeof(char));
 
 		msg->msgType = SUBPING;
-		memcpy((char *)(msg + MSGTYPESIZE), &memberNode->addr.addr, ADDRARYSIZE);
-		Address destination = getListEntryAddr(lastEntry);
-		memcpy((char *)(msg + MSGTYPESIZE + ADDRARYSIZE + 1), &destination.addr, ADDRARYSIZE);//destination address
-
-		//fill payload
-		fillPiggyback((char *)msg, (unsigned int)MSGTYPESIZE + 2*(ADDRARYSIZE + 1));
-
-#ifdef DEBUGLOG
-		sprintf(s, "SUBPING to detect %s is ready.\n", getListEntryAddr(lastEntry).getAddress().c_str());
-		log->LOG(&memberNode->addr, s);
-#endif
-
-		vector<MemberListEntry>::iterator list;
-		//select live neighbors to send subping
-		for (list = memberNode->memberList.begin(); list != memberNode->memberList.end(); list++) {
-			if ( &(*list) != lastEntry && list->timestamp >= 0) {//valid and alive
-				Address toAddr = getListEntryAddr(&(*list));//get the address of neighbor
-#ifdef DEBUGLOG
-				sprintf(s, "Send SUBPING to %s.\n", toAddr.getAddress().c_str());
-				log->LOG(&memberNode->addr, s);
-#endif
-				// send SUBPING message to detect member
-				emulNet->ENsend(&memberNode->addr, &toAddr, (char *)msg, msgsize);
-			}
+		memcpy((char *)msg + MSGTYPESIZE, &memberNode->addr.addr, ADDRARYSIZE);
+		Address destination = getListEntryAddr(probed);
+		memcpy((char *)msg + MSGTYPESIZE + ADDRARYSIZE + 1, &destination.addr, ADDRARYSIZE);//destination address
+
+		TRACE(TRACE_DEBUG, log, &memberNode->addr, "SUBPING to detect %s is ready.\n", destination.getAddress().c_str());
+
+		//ask up to PROBE_K live neighbors to probe it for me
+		vector<MemberHandle> probers;
+		sampleProbers(lastEntry, probers);
+		for (unsigned int i = 0; i < probers.size(); i++) {
+			Address toAddr = getListEntryAddr(memberNode->memberList.get(probers[i]));//get the address of neighbor
+			TRACE(TRACE_DEBUG, log, &memberNode->addr, "Send SUBPING to %s.\n", toAddr.getAddress().c_str());
+			// send SUBPING message to detect member
+			queueMessage(&toAddr, (char *)msg, msgsize);
 		}
+		indirectProbes++;
+		indirectProbers += probers.size();
 		free(msg);
 	}
 	else {
-#ifdef DEBUGLOG
-		sprintf(s, "No neighbor aviliable.\n");
-		log->LOG(&memberNode->addr, s);
-#endif
+		TRACE(TRACE_DEBUG, log, &memberNode->addr, "No neighbor aviliable.\n");
 	}
 }
 
@@ -879,30 +1050,20 @@ void MP1Node::sendSubping() {
 * DESCRIPTION: prepare subpringreq message with message type, from address, to address and piggyback infos then send
 */
 void MP1Node::sendSubpingreq(Address* srcaddr, Address* destaddr) {
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "sendSubpingreq.\n");
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "sendSubpingreq.\n");
 
 	//prepare message
-	size_t msgsize = MSGTYPESIZE + 2 * (ADDRARYSIZE + 1) + sizeof(size_t) + sizeof(MemberListEntry) * memberNode->memberList.size();
+	size_t msgsize = MSGTYPESIZE + 2 * (ADDRARYSIZE + 1);
 	MessageHdr* msg = (MessageHdr *)malloc(msgsize * sizeof(char));
 
 	msg->msgType = SUBPINGREQ;
 	memcpy((char *)msg + MSGTYPESIZE, &srcaddr->addr, ADDRARYSIZE);
 	memcpy((char *)msg + MSGTYPESIZE + ADDRARYSIZE + 1, &memberNode->addr.addr , ADDRARYSIZE);//destination address
 
-	//fill payload
-	fillPiggyback((char *)msg, (unsigned int)MSGTYPESIZE + 2 * (ADDRARYSIZE + 1));
-
-#ifdef DEBUGLOG
-	sprintf(s, "Send SUBPINGREQ to %s.\n", destaddr->getAddress().c_str());
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "Send SUBPINGREQ to %s.\n", destaddr->getAddress().c_str());
 
 	// send SUBPING message to detect member
-	emulNet->ENsend(&memberNode->addr, destaddr, (char *)msg, msgsize);
+	queueMessage(destaddr, (char *)msg, msgsize);
 
 	free(msg);
 
@@ -915,30 +1076,20 @@ void MP1Node::sendSubpingreq(Address* srcaddr, Address* destaddr) {
 * DESCRIPTION: prepare subpringrep message with message type, from address, to address and piggyback infos then send
 */
 void MP1Node::sendSubpingrep(Address* srcaddr, Address* midaddr) {
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "sendSubpingrep.\n");
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "sendSubpingrep.\n");
 
 	//prepare message
-	size_t msgsize = MSGTYPESIZE + 2 * (ADDRARYSIZE + 1) + sizeof(size_t) + sizeof(MemberListEntry) * memberNode->memberList.size();
+	size_t msgsize = MSGTYPESIZE + 2 * (ADDRARYSIZE + 1);
 	MessageHdr* msg = (MessageHdr *)malloc(msgsize * sizeof(char));
 
 	msg->msgType = SUBPINGREP;
 	memcpy((char *)msg + MSGTYPESIZE, &srcaddr->addr, ADDRARYSIZE);
 	memcpy((char *)msg + MSGTYPESIZE + ADDRARYSIZE + 1, &memberNode->addr.addr, ADDRARYSIZE);//destination address
 
-																							 //fill payload
-	fillPiggyback((char *)msg, (unsigned int)MSGTYPESIZE + 2 * (ADDRARYSIZE + 1));
-
-#ifdef DEBUGLOG
-	sprintf(s, "Send SUBPINGREP to %s.\n", midaddr->getAddress().c_str());
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "Send SUBPINGREP to %s.\n", midaddr->getAddress().c_str());
 
 	// send SUBPING message to detect member
-	emulNet->ENsend(&memberNode->addr, midaddr, (char *)msg, msgsize);
+	queueMessage(midaddr, (char *)msg, msgsize);
 
 	free(msg);
 }
@@ -950,33 +1101,140 @@ void MP1Node::sendSubpingrep(Address* srcaddr, Address* midaddr) {
 * DESCRIPTION: prepare subpringrep message with message type, from address, to address and piggyback infos then send
 */
 void MP1Node::sendSubpingack(Address* srcaddr, Address* destaddr) {
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "sendSubpingack.\n");
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "sendSubpingack.\n");
 
 	//prepare message
-	size_t msgsize = MSGTYPESIZE + 2 * (ADDRARYSIZE + 1) + sizeof(size_t) + sizeof(MemberListEntry) * memberNode->memberList.size();
+	size_t msgsize = MSGTYPESIZE + 2 * (ADDRARYSIZE + 1);
 	MessageHdr* msg = (MessageHdr *)malloc(msgsize * sizeof(char));
 
 	msg->msgType = SUBPINGACK;
 	memcpy((char *)msg + MSGTYPESIZE, &destaddr->addr, ADDRARYSIZE);
 	memcpy((char *)msg + MSGTYPESIZE + ADDRARYSIZE + 1, &memberNode->addr.addr, ADDRARYSIZE);//destination address
 
-	fillPiggyback((char *)msg, (unsigned int)MSGTYPESIZE + 2 * (ADDRARYSIZE + 1));
-
-#ifdef DEBUGLOG
-	sprintf(s, "Send sendSubpingack to %s.\n", srcaddr->getAddress().c_str());
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "Send sendSubpingack to %s.\n", srcaddr->getAddress().c_str());
 
 	// send SUBPING message to detect member
-	emulNet->ENsend(&memberNode->addr, srcaddr, (char *)msg, msgsize);
+	queueMessage(srcaddr, (char *)msg, msgsize);
 
 	free(msg);
 }
 
+/**
+* FUNCTION NAME: sendLeave
+*
+* DESCRIPTION: announce that this node leaves to PROBE_K random live
+* 				members; the piggyback takes it further
+*/
+void MP1Node::sendLeave() {
+	vector<MemberHandle> targets;
+	size_t msgsize = messageSize(LEAVE);
+	MessageHdr* msg = (MessageHdr *)malloc(msgsize * sizeof(char));
+
+	msg->msgType = LEAVE;
+	memcpy((char *)msg + MSGTYPESIZE, &memberNode->addr.addr, ADDRARYSIZE);
+	memcpy((char *)msg + MSGTYPESIZE + ADDRARYSIZE + 1, &memberNode->memberList.get(memberNode->myPos)->incarnation, sizeof(unsigned int));
+
+	//my own entry, now left, goes out with every piggyback
+	queueGossip(id);
+	sampleProbers(MemberHandle(), targets);
+	for (unsigned int i = 0; i < targets.size(); i++) {
+		Address toAddr = getListEntryAddr(memberNode->memberList.get(targets[i]));
+		TRACE(TRACE_DEBUG, log, &memberNode->addr, "LEAVE send from %s to %s.\n", memberNode->addr.getAddress().c_str(), toAddr.getAddress().c_str());
+		queueMessage(&toAddr, (char *)msg, msgsize);
+	}
+
+	free(msg);
+}
+
+/**
+* FUNCTION NAME: queueMessage
+*
+* DESCRIPTION: Append a message to this tick's frame for its destination. A
+* 				frame that cannot take it is sent right away and started over.
+*/
+void MP1Node::queueMessage(Address *to, char *msg, size_t size) {
+	size_t capacity = par->MAX_MSG_SIZE - 1 - sizeof(en_msg) - FRAMEHDRSIZE - MemberCodec::maxSize(par->PIGGYBACK_MAX);
+	unsigned short length = (unsigned short)size;
+	OutFrame *frame = NULL;
+
+	for (unsigned int i = 0; i < frames.size(); i++) {
+		if (0 == memcmp(frames[i].to.addr, to->addr, ADDRARYSIZE)) {
+			frame = &frames[i];
+			break;
+		}
+	}
+	if (frame == NULL) {
+		frames.push_back(OutFrame());
+		frame = &frames.back();
+		frame->to = *to;
+		frame->count = 0;
+	}
+
+	if (frame->count == FRAME_MAX_MSGS || frame->body.size() + FRAMELENSIZE + size > capacity) {
+		flushFrame(*frame);
+	}
+	frame->body.insert(frame->body.end(), (char *)&length, (char *)&length + FRAMELENSIZE);
+	frame->body.insert(frame->body.end(), msg, msg + size);
+	frame->count++;
+
+	sentTypes[((MessageHdr *)msg)->msgType].msgs++;
+	sentTypes[((MessageHdr *)msg)->msgType].bytes += size;
+}
+
+/**
+* FUNCTION NAME: flushFrame
+*
+* DESCRIPTION: Send the messages queued in frame with one piggyback section
+* 				after them, and empty it. A lone message is sent as it is,
+* 				with the piggyback right after it.
+*/
+void MP1Node::flushFrame(OutFrame &frame) {
+	unsigned int offset;
+	MessageHdr* msg;
+
+	if (frame.count == 0) {
+		return;
+	}
+
+	if (frame.count == 1) {
+		offset = frame.body.size() - FRAMELENSIZE;
+		msg = (MessageHdr *)malloc((offset + piggybackSize()) * sizeof(char));
+		memcpy((char *)msg, frame.body.data() + FRAMELENSIZE, offset);
+	}
+	else {
+		offset = FRAMEHDRSIZE + frame.body.size();
+		msg = (MessageHdr *)malloc((offset + piggybackSize()) * sizeof(char));
+		msg->msgType = FRAME;
+		*((char *)msg + MSGTYPESIZE) = (char)frame.count;
+		memcpy((char *)msg + FRAMEHDRSIZE, frame.body.data(), frame.body.size());
+	}
+
+	//fill payload
+	size_t msgsize = offset + fillPiggyback((char *)msg, offset);
+
+	TRACE(TRACE_DEBUG, log, &memberNode->addr, "Send FRAME of %d messages to %s.\n", frame.count, frame.to.getAddress().c_str());
+
+	emulNet->ENsend(&memberNode->addr, &frame.to, (char *)msg, msgsize);
+	framesSent++;
+
+	free(msg);
+	frame.body.clear();
+	frame.count = 0;
+}
+
+/**
+* FUNCTION NAME: flushFrames
+*
+* DESCRIPTION: Send every frame queued this tick, in the order their
+* 				destinations were first sent to
+*/
+void MP1Node::flushFrames() {
+	for (unsigned int i = 0; i < frames.size(); i++) {
+		flushFrame(frames[i]);
+	}
+	frames.clear();
+}
+
 /**
  * FUNCTION NAME: isNullAddress
  *
@@ -1004,66 +1262,224 @@ Address MP1Node::getJoinAddress() {
 /**
 * FUNCTION NAME: logRemoveEntry
 *
-* DESCRIPTION: Called when lastentry is not NULL, build address of lastEntry and log it.
+* DESCRIPTION: Called when the entry was noticed to be failed, build address of lastEntry and log it.
 */
-void MP1Node::logRemoveEntry() {
+void MP1Node::logRemoveEntry(MemberListEntry *entryToRemove) {
 
 	//build addr of removed node
 	Address neighborAddr;
 	memset(&neighborAddr, 0, sizeof(Address));
-	*(int *)(&neighborAddr.addr) = lastEntry->id;
-	*(short *)(&neighborAddr.addr[4]) = lastEntry->port;
+	*(int *)(&neighborAddr.addr) = entryToRemove->id;
+	*(short *)(&neighborAddr.addr[4]) = entryToRemove->port;
 
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "Node %s was removed from node %s at %d.\n", neighborAddr.getAddress().c_str(), memberNode->addr.getAddress().c_str(), par->globaltime);
-	log->LOG(&memberNode->addr, s);
-#endif
+	TRACE(TRACE_INFO, log, &memberNode->addr, "Node %s was declared dead by node %s at %d.\n", neighborAddr.getAddress().c_str(), memberNode->addr.getAddress().c_str(), par->globaltime);
 
 	//log the remove node
 	log->logNodeRemove(&memberNode->addr, &neighborAddr);
+	noteRemoved(entryToRemove->id);
 }
 
 /**
-* FUNCTION NAME: logRemoveEntry
+* FUNCTION NAME: logLeftEntry
 *
-* DESCRIPTION: Called when the entry was noticed to be failed, build address of lastEntry and log it.
+* DESCRIPTION: Called when the entry was noticed to have left, log its removal
 */
-void MP1Node::logRemoveEntry(MemberListEntry *entryToRemove) {
+void MP1Node::logLeftEntry(MemberListEntry *entryLeft) {
+	Address leftAddr = getListEntryAddr(entryLeft);
 
-	//build addr of removed node
+	TRACE(TRACE_INFO, log, &memberNode->addr, "Node %s left, noticed by node %s at %d.\n", leftAddr.getAddress().c_str(), memberNode->addr.getAddress().c_str(), par->globaltime);
+
+	log->logNodeRemove(&memberNode->addr, &leftAddr);
+}
+
+/**
+* FUNCTION NAME: noteRemoved
+*
+* DESCRIPTION: Remember when a member was first logged removed since it
+* 				was last logged added, for the detection latency report
+*/
+void MP1Node::noteRemoved(int id) {
+	if (removedAt.find(id) == removedAt.end()) {
+		removedAt[id] = par->getcurrtime();
+	}
+}
+
+
+
+/**
+* FUNCTION NAME: getNextNeighbor
+*
+* DESCRIPTION: Returns the Address of the next live neighbor in the probe
+* 				order, or a null address if there is none
+*/
+Address MP1Node::getNextNeighbor() {
 	Address neighborAddr;
-	memset(&neighborAddr, 0, sizeof(Address));
-	*(int *)(&neighborAddr.addr) = entryToRemove->id;
-	*(short *)(&neighborAddr.addr[4]) = entryToRemove->port;
 
-#ifdef DEBUGLOG
-	static char s[1024];
-	sprintf(s, "Node %s was removed from node %s at %d.\n", neighborAddr.getAddress().c_str(), memberNode->addr.getAddress().c_str(), par->globaltime);
-	log->LOG(&memberNode->addr, s);
-#endif
+	lastEntry = nextProbeTarget();
+	if (lastEntry.isNull()) {
+		memset(&neighborAddr, 0, sizeof(Address));
+		return neighborAddr;
+	}
 
-	//log the remove node
-	log->logNodeRemove(&memberNode->addr, &neighborAddr);
+	return getListEntryAddr(memberNode->memberList.get(lastEntry));
 }
 
 
+/**
+* FUNCTION NAME: nextProbeTarget
+*
+* DESCRIPTION: Walk the probe order, skipping members that are no longer
+* 				alive. At the end of a pass start a new one over the current
+* 				live set in a fresh random order, so every live member is
+* 				probed once per pass and at most 2n-1 periods apart.
+*/
+MemberHandle MP1Node::nextProbeTarget() {
+	LiveSet &live = memberNode->liveSet;
+
+	while (true) {
+		while (probeNext < probeOrder.size()) {
+			MemberHandle handle = probeOrder[probeNext++];
+			if (live.contains(handle)) {
+				return handle;
+			}
+		}
+		if (live.size() == 0) {
+			return MemberHandle();
+		}
+
+		probeOrder.clear();
+		for (int i = 0; i < live.size(); i++) {
+			probeOrder.push_back(live[i]);
+		}
+		for (int i = probeOrder.size() - 1; i > 0; i--) {
+			swap(probeOrder[i], probeOrder[rng.nextInt(i + 1)]);
+		}
+		probeNext = 0;
+	}
+}
+
 
 /**
-* FUNCTION NAME: getRandomNeighbor
+* FUNCTION NAME: scheduleProbe
 *
-* DESCRIPTION: Returns the Address of the selected random living neighbor
+* DESCRIPTION: Put a member that became alive at a random position among
+* 				those not yet probed in this pass
 */
-Address MP1Node::getRandomNeighbor() {
-	int i = rand() % memberNode->memberList.size();
+void MP1Node::scheduleProbe(MemberHandle handle) {
+	probeOrder.push_back(handle);
+	swap(probeOrder.back(), probeOrder[probeNext + rng.nextInt(probeOrder.size() - probeNext)]);
+}
+
 
-	while (memberNode->memberList[i].timestamp == -1 || i==0) {
-		i = rand() % memberNode->memberList.size();
+/**
+* FUNCTION NAME: sampleProbers
+*
+* DESCRIPTION: Fill probers with up to PROBE_K live members other than the
+* 				probed one, drawn uniformly without repeats. A partial
+* 				Fisher-Yates shuffle of the live set, so O(k).
+*/
+void MP1Node::sampleProbers(MemberHandle probed, vector<MemberHandle> &probers) {
+	LiveSet &live = memberNode->liveSet;
+	int n = live.size();
+
+	probers.clear();
+	for (int i = 0; i < n && (int)probers.size() < par->PROBE_K; i++) {
+		live.swap(i, i + rng.nextInt(n - i));
+		if (live[i] != probed) {
+			probers.push_back(live[i]);
+		}
 	}
-	
-	lastEntry = &memberNode->memberList[i];
+}
+
 
-	return getListEntryAddr(lastEntry);
+/**
+* FUNCTION NAME: markAlive
+*
+* DESCRIPTION: Mark an entry alive and put it in the live set
+*/
+void MP1Node::markAlive(MemberHandle handle) {
+	MemberListEntry *entry = memberNode->memberList.get(handle);
+
+	entry->status = MEMBER_ALIVE;
+	entry->timestamp = par->globaltime;
+	if (handle != memberNode->myPos && !memberNode->liveSet.contains(handle)) {
+		memberNode->liveSet.add(handle);
+		scheduleProbe(handle);
+	}
+	memberNode->nnb = memberNode->liveSet.size();
+}
+
+
+/**
+* FUNCTION NAME: markSuspect
+*
+* DESCRIPTION: Mark an entry suspected and start its suspicion timeout. It
+* 				stays in the live set until it is declared dead.
+*/
+void MP1Node::markSuspect(MemberHandle handle) {
+	MemberListEntry *entry = memberNode->memberList.get(handle);
+
+	if (entry->status == MEMBER_DEAD || entry->status == MEMBER_LEFT) {
+		markAlive(handle);
+	}
+	entry->status = MEMBER_SUSPECT;
+	entry->timestamp = par->globaltime;
+	suspects.push_back(handle);
+}
+
+
+/**
+* FUNCTION NAME: markFailed
+*
+* DESCRIPTION: Mark an entry dead, or left, and take it out of the live set
+*/
+void MP1Node::markFailed(MemberHandle handle, MemberStatus status) {
+	MemberListEntry *entry = memberNode->memberList.get(handle);
+
+	entry->status = status;
+	entry->timestamp = par->globaltime;
+	memberNode->liveSet.remove(handle);
+	memberNode->nnb = memberNode->liveSet.size();
+	tombstones.push_back(handle);
+}
+
+/**
+* FUNCTION NAME: compactMemberList
+*
+* DESCRIPTION: Erase the entries that have been dead or left for TCOMPACT
+* 				ticks, oldest first, once their change has been piggybacked
+* 				at least once; a change still queued is dropped with them.
+* 				Their incarnation is remembered, so only a rejoin brings
+* 				them back.
+*/
+void MP1Node::compactMemberList() {
+	while (!tombstones.empty()) {
+		MemberHandle handle = tombstones.front();
+		MemberListEntry *entry = memberNode->memberList.get(handle);
+
+		//revived since, or already gone
+		if (entry == NULL || (entry->status != MEMBER_DEAD && entry->status != MEMBER_LEFT)) {
+			tombstones.pop_front();
+			continue;
+		}
+		if (par->globaltime - entry->timestamp < TCOMPACT) {
+			return;
+		}
+		for (unsigned int i = 0; i < gossip.size(); i++) {
+			if (gossip[i].id == entry->id) {
+				if (gossip[i].sent == 0) {
+					return;
+				}
+				gossip.erase(gossip.begin() + i);
+				break;
+			}
+		}
+
+		TRACE(TRACE_DEBUG, log, &memberNode->addr, "Compacted the entry of node id=%d.\n", entry->id);
+		forgotten[entry->id] = entry->incarnation;
+		memberNode->memberList.erase(handle);
+		tombstones.pop_front();
+	}
 }
 
 
@@ -1088,6 +1504,12 @@ Address MP1Node::getListEntryAddr(MemberListEntry* entry) {
  */
 void MP1Node::initMemberListTable(Member *memberNode) {
 	memberNode->memberList.clear();
+	memberNode->liveSet.clear();
+	suspects.clear();
+	tombstones.clear();
+	forgotten.clear();
+	probeOrder.clear();
+	probeNext = 0;
 }
 
 /**
@@ -1104,11 +1526,11 @@ void MP1Node::printAddress(Address *addr)
 /**
 * FUNCTION NAME: initCounter
 *
-* DESCRIPTION: reset the counter and time out
+* DESCRIPTION: set the deadlines of a new ping period
 */
 void MP1Node::initCounter() {
-	memberNode->pingCounter = TREMOVE;
-	memberNode->timeOutCounter = TFAIL;
+	memberNode->nextPing = par->getcurrtime() + TREMOVE;
+	memberNode->pingTimeout = par->getcurrtime() + TFAIL;
 }
 
 /**
@@ -1118,16 +1540,34 @@ void MP1Node::initCounter() {
 */
 void MP1Node::updateStatus() {
 	memberNode->heartbeat++;
-	memberNode->myPos->heartbeat = memberNode->heartbeat;
+	memberNode->memberList.get(memberNode->myPos)->heartbeat = memberNode->heartbeat;
 }
 
 /**
-* FUNCTION NAME: countDownCounter
+* FUNCTION NAME: nextWake
 *
-* DESCRIPTION: decrement every counter
+* DESCRIPTION: The next tick this node has to run at even if no message
+* 				comes in: the end of the ping period, the ping timeout, or
+* 				the earliest suspicion timeout. -1 if only a message can
+* 				give it something to do.
 */
-void MP1Node::countDownCounter() {
-	memberNode->pingCounter--;
-	memberNode->timeOutCounter--;
+int MP1Node::nextWake() {
+	int wake;
+
+	if (memberNode->bFailed || !memberNode->inGroup) {
+		return -1;
+	}
+
+	wake = memberNode->nextPing;
+	if (memberNode->pingTimeout >= 0) {
+		wake = min(wake, memberNode->pingTimeout);
+	}
+	for (unsigned int i = 0; i < suspects.size(); i++) {
+		MemberListEntry *entry = memberNode->memberList.get(suspects[i]);
+		if (entry != NULL && entry->status == MEMBER_SUSPECT) {
+			wake = min(wake, (int)entry->timestamp + par->SUSPECT_TIMEOUT);
+		}
+	}
+	return wake;
 }
 
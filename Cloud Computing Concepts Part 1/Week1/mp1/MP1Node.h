@@ -14,6 +14,8 @@
 #include "Member.h"
 #include "EmulNet.h"
 #include "Queue.h"
+#include "MemberCodec.h"
+#include "Random.h"
 #include <map>
 #include <algorithm>
 
@@ -22,9 +24,16 @@
  */
 #define TREMOVE 20
 #define TFAIL 5
+// ticks a dead or departed entry is kept before it is compacted
+#define TCOMPACT (3 * TREMOVE)
 #define MSGTYPESIZE sizeof(MessageHdr)
 #define ADDRSIZE sizeof(Address)
 #define ADDRARYSIZE sizeof(memberNode->addr.addr)
+// frame header: the FRAME type and a 1-byte message count
+#define FRAMEHDRSIZE (MSGTYPESIZE + 1)
+// each message in a frame is prefixed by its length
+#define FRAMELENSIZE sizeof(unsigned short)
+#define FRAME_MAX_MSGS 255
 
 /*
  * Note: You can change/add any functions in MP1Node.{h,cpp}
@@ -42,6 +51,8 @@ enum MsgTypes{
 	SUBPINGREQ,
 	SUBPINGREP,
 	SUBPINGACK,
+	FRAME,
+	LEAVE,
     DUMMYLASTMSGTYPE
 };
 
@@ -54,6 +65,30 @@ typedef struct MessageHdr {
 	enum MsgTypes msgType;
 }MessageHdr;
 
+/**
+ * STRUCT NAME: GossipEntry
+ *
+ * DESCRIPTION: A membership change waiting to be piggybacked, and the
+ * 				number of messages it has been piggybacked on so far
+ */
+typedef struct GossipEntry {
+	int id;
+	int sent;
+}GossipEntry;
+
+/**
+ * STRUCT NAME: OutFrame
+ *
+ * DESCRIPTION: Messages queued for one destination this tick, each
+ * 				prefixed by its length. Two or more go out as a single FRAME
+ * 				message sharing one piggyback section.
+ */
+typedef struct OutFrame {
+	Address to;
+	vector<char> body;
+	int count;
+}OutFrame;
+
 /**
  * CLASS NAME: MP1Node
  *
@@ -63,29 +98,58 @@ class MP1Node {
 private:
 	EmulNet *emulNet;
 	Log *log;
+	// counts received messages and piggybacks, or NULL for none
+	Metrics *metrics;
 	Params *par;
 	Member *memberNode;
-	MemberListEntry *lastEntry;
+	// entry being probed, null when no probe is outstanding
+	MemberHandle lastEntry;
+	// recent membership changes to disseminate
+	vector<GossipEntry> gossip;
+	// entries that were suspected, checked each tick for timeout
+	vector<MemberHandle> suspects;
+	// entries marked dead or left, oldest first, to compact from the member list
+	deque<MemberHandle> tombstones;
+	// incarnation of each compacted member; news about it no newer is stale
+	map<int, unsigned int> forgotten;
+	// this node's own random sequence, nodes may run on different threads
+	Random rng;
+	// shuffled round-robin probe order and the next position in it
+	vector<MemberHandle> probeOrder;
+	unsigned int probeNext;
+	// time each member was first logged removed since it last (re)joined
+	map<int, int> removedAt;
+	// direct probes sent, indirect probe rounds started and members asked in them
+	long probes;
+	long indirectProbes;
+	long indirectProbers;
+	// messages waiting to be sent at the end of this nodeLoop, one frame per destination
+	vector<OutFrame> frames;
+	// logical messages queued by type, and frames put on the network
+	en_typecount sentTypes[DUMMYLASTMSGTYPE];
+	long framesSent;
 	int id;
 	int port;
 	char NULLADDR[6];
 
 public:
-	MP1Node(Member *, Params *, EmulNet *, Log *, Address *);
+	MP1Node(Member *, Params *, EmulNet *, Log *, Metrics *, Address *);
 	Member * getMemberNode() {
 		return memberNode;
 	}
 	int recvLoop();
-	static int enqueueWrapper(void *env, char *buff, int size);
+	static int enqueueWrapper(void *env, MsgView msg);
 	void nodeStart(char *servaddrstr, short serverport);
+	void nodeRestart(Address *joinaddr);
 	int initThisNode(Address *joinaddr);
 	int introduceSelfToGroup(Address *joinAddress);
 	int finishUpThisNode();
 	void nodeLoop();
 	void checkMessages();
 	bool recvCallBack(void *env, char *data, int size);
+	size_t messageSize(enum MsgTypes type);
 	bool joinHandler(char *data, int size);
-	void joinrepHandler();
+	void joinrepHandler(char *data, int size);
 
 	void pingHandler(char *data);
 	void ackHandler(char *data, int size);
@@ -93,6 +157,8 @@ public:
 	void subpingreqHandler(char *data, size_t size);
 	void subpingrepHandler(char *data, size_t size);
 	void subpingackHandler(char *data, size_t size);
+	void frameHandler(char *data, int size);
+	void leaveHandler(char *data);
 
 	void nodeLoopOps();
 	int isNullAddress(Address *addr);
@@ -101,10 +167,13 @@ public:
 	void printAddress(Address *addr);
 	void initCounter();
 	void updateStatus();
-	void countDownCounter();
+	int nextWake();
 	void checkCounter();
-	void fillPiggyback(char *msg, unsigned int offset);
-	void processPiggyback(char *msg, unsigned int offset);
+	void queueGossip(int id);
+	size_t piggybackSize();
+	size_t fillPiggyback(char *msg, unsigned int offset);
+	size_t fillMemberList(char *msg, unsigned int offset, size_t capacity);
+	void processPiggyback(char *msg, unsigned int offset, int msgsize);
 
 	void updateMemberList(MemberListEntry* entry);
 
@@ -114,10 +183,43 @@ public:
 	void sendSubpingreq(Address* srcaddr, Address* destaddr);
 	void sendSubpingrep(Address* srcaddr, Address* midaddr);
 	void sendSubpingack(Address* srcaddr, Address* destaddr);
+	void sendLeave();
+	void queueMessage(Address *to, char *msg, size_t size);
+	void flushFrame(OutFrame &frame);
+	void flushFrames();
 
-	Address getRandomNeighbor();
-	void logRemoveEntry();
+	Address getNextNeighbor();
+	MemberHandle nextProbeTarget();
+	void scheduleProbe(MemberHandle handle);
+	void noteRemoved(int id);
+	int getRemovedAt(int id) {
+		map<int, int>::iterator it = removedAt.find(id);
+		return it == removedAt.end() ? -1 : it->second;
+	}
+	void sampleProbers(MemberHandle probed, vector<MemberHandle> &probers);
+	void markAlive(MemberHandle handle);
+	void markSuspect(MemberHandle handle);
+	void markFailed(MemberHandle handle, MemberStatus status = MEMBER_DEAD);
+	bool overrides(MemberListEntry *update, MemberListEntry *known);
+	void checkSuspects();
+	void compactMemberList();
+	long getProbes() {
+		return probes;
+	}
+	long getIndirectProbes() {
+		return indirectProbes;
+	}
+	long getIndirectProbers() {
+		return indirectProbers;
+	}
+	en_typecount getSentType(int type) {
+		return sentTypes[type];
+	}
+	long getFramesSent() {
+		return framesSent;
+	}
 	void logRemoveEntry(MemberListEntry *entryToRemove);
+	void logLeftEntry(MemberListEntry *entryLeft);
 	Address getListEntryAddr(MemberListEntry* entry);
 
 	virtual ~MP1Node();
@@ -9,7 +9,7 @@
 /**
  * Constructor
  */
-q_elt::q_elt(void *elt, int size): elt(elt), size(size) {}
+q_elt::q_elt(MsgView msg): msg(std::move(msg)) {}
 
 /**
  * Copy constructor
@@ -40,12 +40,12 @@ bool Address::operator ==(const Address& anotherAddress) {
 /**
  * Constructor
  */
-MemberListEntry::MemberListEntry(int id, short port, long heartbeat, long timestamp): id(id), port(port), heartbeat(heartbeat), timestamp(timestamp) {}
+MemberListEntry::MemberListEntry(int id, short port, long heartbeat, long timestamp): id(id), port(port), heartbeat(heartbeat), timestamp(timestamp), status(MEMBER_ALIVE), incarnation(0) {}
 
 /**
  * Constuctor
  */
-MemberListEntry::MemberListEntry(int id, short port): id(id), port(port) {}
+MemberListEntry::MemberListEntry(int id, short port): id(id), port(port), status(MEMBER_ALIVE), incarnation(0) {}
 
 /**
  * Copy constructor
@@ -55,6 +55,8 @@ MemberListEntry::MemberListEntry(const MemberListEntry &anotherMLE) {
 	this->id = anotherMLE.id;
 	this->port = anotherMLE.port;
 	this->timestamp = anotherMLE.timestamp;
+	this->status = anotherMLE.status;
+	this->incarnation = anotherMLE.incarnation;
 }
 
 /**
@@ -66,6 +68,8 @@ MemberListEntry& MemberListEntry::operator =(const MemberListEntry &anotherMLE)
 	swap(id, temp.id);
 	swap(port, temp.port);
 	swap(timestamp, temp.timestamp);
+	swap(status, temp.status);
+	swap(incarnation, temp.incarnation);
 	return *this;
 }
 
@@ -141,6 +145,191 @@ void MemberListEntry::settimestamp(long timestamp) {
 	this->timestamp = timestamp;
 }
 
+/**
+ * Constructor
+ */
+MemberTable::MemberTable() {
+	clear();
+}
+
+/**
+ * FUNCTION NAME: homeOf
+ *
+ * DESCRIPTION: Return the index entry where probing for id starts
+ */
+unsigned int MemberTable::homeOf(int id) {
+	// Fibonacci hashing spreads consecutive ids over the table
+	return ((unsigned int)id * 2654435769u) & (index.size() - 1);
+}
+
+/**
+ * FUNCTION NAME: indexOf
+ *
+ * DESCRIPTION: Return the index entry holding id, or the empty entry where
+ * 				it would go (linear probing)
+ */
+unsigned int MemberTable::indexOf(int id) {
+	unsigned int mask = index.size() - 1;
+	unsigned int i = homeOf(id);
+
+	while ( index[i] != -1 && entries[slotPos[index[i]]].id != id ) {
+		i = (i + 1) & mask;
+	}
+	return i;
+}
+
+/**
+ * FUNCTION NAME: rehash
+ *
+ * DESCRIPTION: Rebuild the index with capacity entries (a power of two)
+ */
+void MemberTable::rehash(unsigned int capacity) {
+	index.assign(capacity, -1);
+	for ( unsigned int pos = 0; pos < entries.size(); pos++ ) {
+		index[indexOf(entries[pos].id)] = posSlot[pos];
+	}
+}
+
+/**
+ * FUNCTION NAME: unindex
+ *
+ * DESCRIPTION: Remove id from the index, shifting back the entries that
+ * 				probed past it so no lookup chain is broken
+ */
+void MemberTable::unindex(int id) {
+	unsigned int mask = index.size() - 1;
+	unsigned int hole = indexOf(id);
+	unsigned int i = hole;
+	unsigned int home;
+
+	index[hole] = -1;
+	while ( true ) {
+		i = (i + 1) & mask;
+		if ( index[i] == -1 ) {
+			return;
+		}
+		home = homeOf(entries[slotPos[index[i]]].id);
+		// move the entry back unless its home lies cyclically in (hole, i]
+		if ( ((i - home) & mask) >= ((i - hole) & mask) ) {
+			index[hole] = index[i];
+			index[i] = -1;
+			hole = i;
+		}
+	}
+}
+
+/**
+ * FUNCTION NAME: find
+ *
+ * DESCRIPTION: Return a handle on the entry for id, or a null handle
+ */
+MemberHandle MemberTable::find(int id) {
+	int slot = index[indexOf(id)];
+
+	if ( slot == -1 ) {
+		return MemberHandle();
+	}
+	return MemberHandle(slot, slotGen[slot]);
+}
+
+/**
+ * FUNCTION NAME: insert
+ *
+ * DESCRIPTION: Append an entry whose id is not in the table yet and
+ * 				return a handle on it
+ */
+MemberHandle MemberTable::insert(const MemberListEntry &entry) {
+	int slot;
+
+	// keep the load factor at or below 1/2
+	if ( 2 * (entries.size() + 1) > index.size() ) {
+		rehash(2 * index.size());
+	}
+
+	if ( freeSlot != -1 ) {
+		slot = freeSlot;
+		freeSlot = slotPos[slot];
+	}
+	else {
+		slot = slotPos.size();
+		slotPos.push_back(0);
+		slotGen.push_back(0);
+		slotUsed.push_back(false);
+	}
+	slotPos[slot] = entries.size();
+	slotUsed[slot] = true;
+	entries.push_back(entry);
+	posSlot.push_back(slot);
+	index[indexOf(entry.id)] = slot;
+	return MemberHandle(slot, slotGen[slot]);
+}
+
+/**
+ * FUNCTION NAME: get
+ *
+ * DESCRIPTION: Return the entry a handle refers to, or NULL if the handle
+ * 				is null or its entry has been erased
+ */
+MemberListEntry *MemberTable::get(MemberHandle handle) {
+	if ( handle.slot < 0 || handle.slot >= (int)slotPos.size() ||
+			!slotUsed[handle.slot] || slotGen[handle.slot] != handle.gen ) {
+		return NULL;
+	}
+	return &entries[slotPos[handle.slot]];
+}
+
+/**
+ * FUNCTION NAME: erase
+ *
+ * DESCRIPTION: Remove the entry a handle refers to by moving the last
+ * 				entry into its place. Handles on the moved entry stay
+ * 				valid, handles on the erased entry go stale.
+ */
+bool MemberTable::erase(MemberHandle handle) {
+	int pos, last;
+
+	if ( get(handle) == NULL ) {
+		return false;
+	}
+	pos = slotPos[handle.slot];
+	last = entries.size() - 1;
+	unindex(entries[pos].id);
+
+	if ( pos != last ) {
+		entries[pos] = entries[last];
+		posSlot[pos] = posSlot[last];
+		slotPos[posSlot[pos]] = pos;
+	}
+	entries.pop_back();
+	posSlot.pop_back();
+
+	slotGen[handle.slot]++;
+	slotUsed[handle.slot] = false;
+	slotPos[handle.slot] = freeSlot;
+	freeSlot = handle.slot;
+	return true;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Remove every entry. Outstanding handles go stale.
+ */
+void MemberTable::clear() {
+	entries.clear();
+	posSlot.clear();
+	freeSlot = -1;
+	for ( unsigned int slot = 0; slot < slotPos.size(); slot++ ) {
+		if ( slotUsed[slot] ) {
+			slotGen[slot]++;
+			slotUsed[slot] = false;
+		}
+		slotPos[slot] = freeSlot;
+		freeSlot = slot;
+	}
+	index.assign(16, -1);
+}
+
 /**
  * Copy Constructor
  */
@@ -151,10 +340,11 @@ Member::Member(const Member &anotherMember) {
 	this->bFailed = anotherMember.bFailed;
 	this->nnb = anotherMember.nnb;
 	this->heartbeat = anotherMember.heartbeat;
-	this->pingCounter = anotherMember.pingCounter;
-	this->timeOutCounter = anotherMember.timeOutCounter;
+	this->nextPing = anotherMember.nextPing;
+	this->pingTimeout = anotherMember.pingTimeout;
 	this->memberList = anotherMember.memberList;
 	this->myPos = anotherMember.myPos;
+	this->liveSet = anotherMember.liveSet;
 	this->mp1q = anotherMember.mp1q;
 }
 
@@ -168,10 +358,82 @@ Member& Member::operator =(const Member& anotherMember) {
 	this->bFailed = anotherMember.bFailed;
 	this->nnb = anotherMember.nnb;
 	this->heartbeat = anotherMember.heartbeat;
-	this->pingCounter = anotherMember.pingCounter;
-	this->timeOutCounter = anotherMember.timeOutCounter;
+	this->nextPing = anotherMember.nextPing;
+	this->pingTimeout = anotherMember.pingTimeout;
 	this->memberList = anotherMember.memberList;
 	this->myPos = anotherMember.myPos;
+	this->liveSet = anotherMember.liveSet;
 	this->mp1q = anotherMember.mp1q;
 	return *this;
 }
+
+/**
+ * FUNCTION NAME: contains
+ *
+ * DESCRIPTION: Whether handle's entry is in the set
+ */
+bool LiveSet::contains(MemberHandle handle) {
+	if ( handle.isNull() || handle.slot >= (int)slotPos.size() || slotPos[handle.slot] < 0 ) {
+		return false;
+	}
+	return members[slotPos[handle.slot]] == handle;
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Add handle's entry, if it is not in the set yet
+ */
+void LiveSet::add(MemberHandle handle) {
+	if ( handle.isNull() || contains(handle) ) {
+		return;
+	}
+	if ( handle.slot >= (int)slotPos.size() ) {
+		slotPos.resize(handle.slot + 1, -1);
+	}
+	// an older entry of the same slot may still be here
+	if ( slotPos[handle.slot] >= 0 ) {
+		remove(members[slotPos[handle.slot]]);
+	}
+	slotPos[handle.slot] = members.size();
+	members.push_back(handle);
+}
+
+/**
+ * FUNCTION NAME: remove
+ *
+ * DESCRIPTION: Remove handle's entry by moving the last member into its place
+ */
+void LiveSet::remove(MemberHandle handle) {
+	int pos;
+
+	if ( !contains(handle) ) {
+		return;
+	}
+	pos = slotPos[handle.slot];
+	members[pos] = members.back();
+	slotPos[members[pos].slot] = pos;
+	members.pop_back();
+	slotPos[handle.slot] = -1;
+}
+
+/**
+ * FUNCTION NAME: swap
+ *
+ * DESCRIPTION: Exchange the members at positions i and j
+ */
+void LiveSet::swap(int i, int j) {
+	std::swap(members[i], members[j]);
+	slotPos[members[i].slot] = i;
+	slotPos[members[j].slot] = j;
+}
+
+/**
+ * FUNCTION NAME: clear
+ *
+ * DESCRIPTION: Empty the set
+ */
+void LiveSet::clear() {
+	members.clear();
+	slotPos.clear();
+}
@@ -8,6 +8,7 @@
 #define MEMBER_H_
 
 #include "stdincludes.h"
+#include "MsgPool.h"
 
 /**
  * CLASS NAME: q_elt
@@ -16,9 +17,8 @@
  */
 class q_elt {
 public:
-	void *elt;
-	int size;
-	q_elt(void *elt, int size);
+	MsgView msg;
+	q_elt(MsgView msg);
 };
 
 /**
@@ -54,10 +54,24 @@ public:
 	}
 };
 
+/**
+ * Membership status of an entry. MEMBER_LEFT is a member that announced
+ * its departure, and is otherwise treated like MEMBER_DEAD.
+ */
+enum MemberStatus {
+	MEMBER_ALIVE,
+	MEMBER_SUSPECT,
+	MEMBER_DEAD,
+	MEMBER_LEFT
+};
+
 /**
  * CLASS NAME: MemberListEntry
  *
- * DESCRIPTION: Entry in the membership list
+ * DESCRIPTION: Entry in the membership list. status is ordered by
+ * 				incarnation, which only the member itself increments, to
+ * 				refute a suspicion. timestamp is the local time of the
+ * 				last status change.
  */
 class MemberListEntry {
 public:
@@ -65,9 +79,11 @@ public:
 	short port;
 	long heartbeat;
 	long timestamp;
+	MemberStatus status;
+	unsigned int incarnation;
 	MemberListEntry(int id, short port, long heartbeat, long timestamp);
 	MemberListEntry(int id, short port);
-	MemberListEntry(): id(0), port(0), heartbeat(0), timestamp(0) {}
+	MemberListEntry(): id(0), port(0), heartbeat(0), timestamp(0), status(MEMBER_ALIVE), incarnation(0) {}
 	MemberListEntry(const MemberListEntry &anotherMLE);
 	MemberListEntry& operator =(const MemberListEntry &anotherMLE);
 	int getid();
@@ -80,6 +96,109 @@ public:
 	void settimestamp(long timestamp);
 };
 
+/**
+ * CLASS NAME: MemberHandle
+ *
+ * DESCRIPTION: Stable reference to an entry of a MemberTable. It stays
+ * 				valid while the table grows or is compacted, and stops
+ * 				resolving once its entry is erased or the table cleared.
+ */
+class MemberHandle {
+public:
+	int slot;
+	unsigned int gen;
+	MemberHandle(): slot(-1), gen(0) {}
+	MemberHandle(int slot, unsigned int gen): slot(slot), gen(gen) {}
+	bool isNull() {
+		return slot < 0;
+	}
+	bool operator ==(const MemberHandle &anotherHandle) const {
+		return slot == anotherHandle.slot && gen == anotherHandle.gen;
+	}
+	bool operator !=(const MemberHandle &anotherHandle) const {
+		return !(*this == anotherHandle);
+	}
+};
+
+/**
+ * CLASS NAME: MemberTable
+ *
+ * DESCRIPTION: Membership table. Entries are kept in a dense array;
+ * 				erasing one moves the last entry into its place, so removal
+ * 				is O(1) and the order is insertion order only until then.
+ * 				Handles name a slot, and each slot records its entry's
+ * 				position and a generation that is bumped when the entry is
+ * 				erased or the table cleared, so a stale handle is detected
+ * 				instead of pointing at the wrong entry. An open-addressing
+ * 				hash index maps a member id to its slot.
+ */
+class MemberTable {
+private:
+	vector<MemberListEntry> entries;
+	// slot of the entry at each position
+	vector<int> posSlot;
+	// position of each slot's entry, or the next free slot
+	vector<int> slotPos;
+	vector<unsigned int> slotGen;
+	vector<bool> slotUsed;
+	int freeSlot;
+	// hash index of slots, -1 marks an empty index entry
+	vector<int> index;
+	unsigned int homeOf(int id);
+	unsigned int indexOf(int id);
+	void rehash(unsigned int capacity);
+	void unindex(int id);
+public:
+	MemberTable();
+	MemberHandle find(int id);
+	MemberHandle insert(const MemberListEntry &entry);
+	MemberListEntry *get(MemberHandle handle);
+	bool erase(MemberHandle handle);
+	void clear();
+	int size() {
+		return (int)entries.size();
+	}
+	bool empty() {
+		return entries.empty();
+	}
+	MemberListEntry &operator [](int pos) {
+		return entries[pos];
+	}
+	vector<MemberListEntry>::iterator begin() {
+		return entries.begin();
+	}
+	vector<MemberListEntry>::iterator end() {
+		return entries.end();
+	}
+};
+
+/**
+ * CLASS NAME: LiveSet
+ *
+ * DESCRIPTION: The members currently believed alive, as a dense array of
+ * 				handles with a position per table slot. Adding, removing
+ * 				and picking a uniform member are O(1); removal swaps the
+ * 				last member into the hole, so the order is arbitrary.
+ */
+class LiveSet {
+private:
+	vector<MemberHandle> members;
+	// position of each slot's handle in members, or -1
+	vector<int> slotPos;
+public:
+	bool contains(MemberHandle handle);
+	void add(MemberHandle handle);
+	void remove(MemberHandle handle);
+	void swap(int i, int j);
+	void clear();
+	int size() {
+		return (int)members.size();
+	}
+	MemberHandle operator [](int pos) {
+		return members[pos];
+	}
+};
+
 /**
  * CLASS NAME: Member
  *
@@ -100,20 +219,22 @@ public:
 	int nnb;
 	// the node's own heartbeat
 	long heartbeat;
-	// counter for next ping
-	int pingCounter;
-	// counter for ping timeout
-	int timeOutCounter;
+	// time of the next ping
+	int nextPing;
+	// time the outstanding ping is handed to indirect probers, or -1
+	int pingTimeout;
 	// Membership table
-	vector<MemberListEntry> memberList;
-	// My position in the membership table
-	vector<MemberListEntry>::iterator myPos;
+	MemberTable memberList;
+	// My entry in the membership table
+	MemberHandle myPos;
+	// Entries of memberList believed alive, not including mine
+	LiveSet liveSet;
 	// Queue for failure detection messages
 	queue<q_elt> mp1q;
 	/**
 	 * Constructor
 	 */
-	Member(): inited(false), inGroup(false), bFailed(false), nnb(0), heartbeat(0), pingCounter(0), timeOutCounter(0) {}
+	Member(): inited(false), inGroup(false), bFailed(false), nnb(0), heartbeat(0), nextPing(0), pingTimeout(-1) {}
 	// copy constructor
 	Member(const Member &anotherMember);
 	// Assignment operator overloading
@@ -0,0 +1,136 @@
+/**********************************
+ * FILE NAME: MemberCodec.cpp
+ *
+ * DESCRIPTION: Definition of the membership entry wire codec
+ **********************************/
+
+#include "MemberCodec.h"
+
+/**
+ * FUNCTION NAME: encodeVarint
+ *
+ * DESCRIPTION: Write value 7 bits at a time, low bits first, and return the
+ * 				number of bytes written
+ */
+int MemberCodec::encodeVarint(char *buf, unsigned long value) {
+	int n = 0;
+
+	while ( value >= 0x80 ) {
+		buf[n++] = (char)((value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	buf[n++] = (char)value;
+	return n;
+}
+
+/**
+ * FUNCTION NAME: decodeVarint
+ *
+ * DESCRIPTION: Read a value written by encodeVarint and return the number of
+ * 				bytes read, or 0 if it does not end before end or is longer
+ * 				than any varint written
+ */
+int MemberCodec::decodeVarint(const char *buf, const char *end, unsigned long *value) {
+	int n = 0;
+	int shift = 0;
+	unsigned char byte;
+
+	*value = 0;
+	do {
+		if ( buf + n >= end || n == CODEC_VARINT_MAX ) {
+			return 0;
+		}
+		byte = (unsigned char)buf[n++];
+		*value |= (unsigned long)(byte & 0x7f) << shift;
+		shift += 7;
+	} while ( byte & 0x80 );
+	return n;
+}
+
+/**
+ * FUNCTION NAME: maxSize
+ *
+ * DESCRIPTION: Upper bound on the size of a section of count entries
+ */
+size_t MemberCodec::maxSize(size_t count) {
+	return CODEC_HEADER_MAX + count * CODEC_ENTRY_MAX;
+}
+
+/**
+ * FUNCTION NAME: encodeHeader
+ *
+ * DESCRIPTION: Write a section header and return the end of it
+ */
+char *MemberCodec::encodeHeader(char *buf, unsigned short count, long base) {
+	memcpy(buf, &count, sizeof(unsigned short));
+	buf += sizeof(unsigned short);
+	// zigzag keeps small negative values small
+	return buf + encodeVarint(buf, ((unsigned long)base << 1) ^ (unsigned long)(base >> 63));
+}
+
+/**
+ * FUNCTION NAME: decodeHeader
+ *
+ * DESCRIPTION: Read a section header and return the first entry, or NULL
+ * 				if the header runs past end
+ */
+const char *MemberCodec::decodeHeader(const char *buf, const char *end, unsigned short *count, long *base) {
+	unsigned long zigzag;
+	int n;
+
+	if ( end - buf < (long)sizeof(unsigned short) ) {
+		return NULL;
+	}
+	memcpy(count, buf, sizeof(unsigned short));
+	buf += sizeof(unsigned short);
+	if ( (n = decodeVarint(buf, end, &zigzag)) == 0 ) {
+		return NULL;
+	}
+	*base = (long)(zigzag >> 1) ^ -(long)(zigzag & 1);
+	return buf + n;
+}
+
+/**
+ * FUNCTION NAME: encodeEntry
+ *
+ * DESCRIPTION: Write one entry and return the end of it. base should be no
+ * 				higher than its heartbeat; a lower heartbeat still decodes,
+ * 				in the longest varint.
+ */
+char *MemberCodec::encodeEntry(char *buf, MemberListEntry *entry, long base) {
+	buf += encodeVarint(buf, (unsigned int)entry->id);
+	buf += encodeVarint(buf, (unsigned short)entry->port);
+	buf += encodeVarint(buf, (unsigned long)(entry->heartbeat - base));
+	buf += encodeVarint(buf, entry->incarnation);
+	*buf++ = (char)(entry->status & ENTRY_STATUS_MASK);
+	return buf;
+}
+
+/**
+ * FUNCTION NAME: decodeEntry
+ *
+ * DESCRIPTION: Read one entry and return the next one, or NULL if the entry
+ * 				runs past end. The timestamp is left 0 for the receiver to
+ * 				fill in.
+ */
+const char *MemberCodec::decodeEntry(const char *buf, const char *end, MemberListEntry *entry, long base) {
+	unsigned long value[4];
+	int n;
+
+	for ( int i = 0; i < 4; i++ ) {
+		if ( (n = decodeVarint(buf, end, &value[i])) == 0 ) {
+			return NULL;
+		}
+		buf += n;
+	}
+	if ( buf >= end ) {
+		return NULL;
+	}
+	entry->id = (int)value[0];
+	entry->port = (short)value[1];
+	entry->heartbeat = base + (long)value[2];
+	entry->incarnation = (unsigned int)value[3];
+	entry->status = (MemberStatus)(*buf++ & ENTRY_STATUS_MASK);
+	entry->timestamp = 0;
+	return buf;
+}
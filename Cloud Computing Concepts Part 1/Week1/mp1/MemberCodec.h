@@ -0,0 +1,52 @@
+/**********************************
+ * FILE NAME: MemberCodec.h
+ *
+ * DESCRIPTION: Header file of the membership entry wire codec
+ **********************************/
+
+#ifndef _MEMBERCODEC_H_
+#define _MEMBERCODEC_H_
+
+#include "stdincludes.h"
+#include "Member.h"
+
+/*
+ * Macros
+ */
+// largest encoded entry: id (5) + port (3) + heartbeat delta (10) + incarnation (5) + flags (1)
+#define CODEC_ENTRY_MAX 24
+// largest section header: count (2) + base heartbeat (10)
+#define CODEC_HEADER_MAX 12
+// longest varint of an unsigned long
+#define CODEC_VARINT_MAX 10
+// entry flags: the low bits hold the MemberStatus
+#define ENTRY_STATUS_MASK 0x03
+
+/**
+ * CLASS NAME: MemberCodec
+ *
+ * DESCRIPTION: Packed encoding of a list of MemberListEntry, read and
+ * 				written in place in a message buffer.
+ *
+ * 				A section is a 2-byte entry count and the base heartbeat, the
+ * 				lowest of its entries, as a zigzag varint, followed by the
+ * 				entries. Each entry is its id and port as varints, its
+ * 				heartbeat as a varint delta from the base, its incarnation
+ * 				as a varint, and a flags byte holding its status. The
+ * 				timestamp is local state and is not sent.
+ *
+ * 				Decoding never reads at or past end: a section cut short
+ * 				or corrupt fails with NULL instead.
+ */
+class MemberCodec {
+public:
+	static int encodeVarint(char *buf, unsigned long value);
+	static int decodeVarint(const char *buf, const char *end, unsigned long *value);
+	static size_t maxSize(size_t count);
+	static char *encodeHeader(char *buf, unsigned short count, long base);
+	static const char *decodeHeader(const char *buf, const char *end, unsigned short *count, long *base);
+	static char *encodeEntry(char *buf, MemberListEntry *entry, long base);
+	static const char *decodeEntry(const char *buf, const char *end, MemberListEntry *entry, long base);
+};
+
+#endif /* _MEMBERCODEC_H_ */
@@ -0,0 +1,192 @@
+/**********************************
+ * FILE NAME: Metrics.cpp
+ *
+ * DESCRIPTION: Definition of the metrics registry
+ **********************************/
+
+#include "Metrics.h"
+
+thread_local MetricBatch *Metrics::batch = NULL;
+
+/**
+ * Constructor
+ * types is the number of message types to write columns for. metrics.csv
+ * is only created when METRICS_INTERVAL is set.
+ */
+Metrics::Metrics(Params *par, int types): par(par), file(NULL), types(min(types, METRIC_TYPES)), lastSnapshot(0) {
+	on = par->METRICS_INTERVAL > 0;
+	memset(&counts, 0, sizeof(counts));
+	nodes = membersMin = membersMax = members = 0;
+	if ( !on ) {
+		return;
+	}
+
+	file = fopen(METRICS_LOG, "w");
+	fprintf(file, "time,ticks");
+	for ( int i = 0; i < this->types; i++ ) {
+		fprintf(file, ",sent_%d,bytes_%d", i, i);
+	}
+	for ( int i = 0; i < this->types; i++ ) {
+		fprintf(file, ",recv_%d", i);
+	}
+	for ( int b = 0; b < METRIC_SIZE_BUCKETS; b++ ) {
+		fprintf(file, ",size_le_%d", (1 << b) - 1);
+	}
+	fprintf(file, ",piggybacks,piggyback_entries,queue_max,queued,nodes,members_min,members_avg,members_max\n");
+}
+
+/**
+ * Destructor
+ */
+Metrics::~Metrics() {
+	if ( file ) {
+		fclose(file);
+	}
+}
+
+/**
+ * FUNCTION NAME: setBatch
+ *
+ * DESCRIPTION: Make the calling thread count into batch, or into the
+ * 				registry again with NULL
+ */
+void Metrics::setBatch(MetricBatch *batch) {
+	Metrics::batch = batch;
+}
+
+/**
+ * FUNCTION NAME: flushBatch
+ *
+ * DESCRIPTION: Add a worker's counts to the registry and clear them. Only
+ * 				while the worker is not counting, at the tick barrier.
+ */
+void Metrics::flushBatch(MetricBatch *batch) {
+	if ( !on ) {
+		return;
+	}
+	for ( int i = 0; i < METRIC_TYPES; i++ ) {
+		counts.sent[i] += batch->sent[i];
+		counts.sentBytes[i] += batch->sentBytes[i];
+		counts.recv[i] += batch->recv[i];
+	}
+	for ( int b = 0; b < METRIC_SIZE_BUCKETS; b++ ) {
+		counts.sizes[b] += batch->sizes[b];
+	}
+	counts.piggybacks += batch->piggybacks;
+	counts.piggybackEntries += batch->piggybackEntries;
+	counts.queueMax = max(counts.queueMax, batch->queueMax);
+	counts.queued += batch->queued;
+	memset(batch, 0, sizeof(MetricBatch));
+}
+
+/**
+ * FUNCTION NAME: countSent
+ *
+ * DESCRIPTION: Count a message of bytes put on the network
+ */
+void Metrics::countSent(int type, int bytes) {
+	if ( !on ) {
+		return;
+	}
+	MetricBatch &counts = current();
+	int bucket = 0;
+
+	while ( bucket < METRIC_SIZE_BUCKETS - 1 && (1 << bucket) <= bytes ) {
+		bucket++;
+	}
+	counts.sizes[bucket]++;
+	if ( type >= 0 && type < METRIC_TYPES ) {
+		counts.sent[type]++;
+		counts.sentBytes[type] += bytes;
+	}
+}
+
+/**
+ * FUNCTION NAME: countRecv
+ *
+ * DESCRIPTION: Count a message taken off a node's queue
+ */
+void Metrics::countRecv(int type) {
+	if ( on && type >= 0 && type < METRIC_TYPES ) {
+		current().recv[type]++;
+	}
+}
+
+/**
+ * FUNCTION NAME: countPiggyback
+ *
+ * DESCRIPTION: Count a piggyback of entries member list entries
+ */
+void Metrics::countPiggyback(int entries) {
+	if ( on ) {
+		MetricBatch &counts = current();
+		counts.piggybacks++;
+		counts.piggybackEntries += entries;
+	}
+}
+
+/**
+ * FUNCTION NAME: countQueue
+ *
+ * DESCRIPTION: Count the depth of a node's queue once it has received
+ */
+void Metrics::countQueue(int depth) {
+	if ( on ) {
+		MetricBatch &counts = current();
+		counts.queueMax = max(counts.queueMax, (long)depth);
+		counts.queued += depth;
+	}
+}
+
+/**
+ * FUNCTION NAME: sampleMembers
+ *
+ * DESCRIPTION: Gauge the member list of one live node for the coming
+ * 				snapshot
+ */
+void Metrics::sampleMembers(int size) {
+	membersMin = nodes ? min(membersMin, (long)size) : size;
+	membersMax = nodes ? max(membersMax, (long)size) : size;
+	members += size;
+	nodes++;
+}
+
+/**
+ * FUNCTION NAME: due
+ *
+ * DESCRIPTION: Whether a snapshot is due at tick now. Ticks skipped by the
+ * 				run are left out, so a row can cover more than the interval.
+ */
+bool Metrics::due(int now) {
+	return on && now - lastSnapshot >= par->METRICS_INTERVAL;
+}
+
+/**
+ * FUNCTION NAME: snapshot
+ *
+ * DESCRIPTION: Write the counts since the last snapshot and the sampled
+ * 				gauges as a row of metrics.csv, then start them over
+ */
+void Metrics::snapshot(int now) {
+	if ( !on ) {
+		return;
+	}
+
+	fprintf(file, "%d,%d", now, now - lastSnapshot);
+	for ( int i = 0; i < types; i++ ) {
+		fprintf(file, ",%ld,%ld", counts.sent[i], counts.sentBytes[i]);
+	}
+	for ( int i = 0; i < types; i++ ) {
+		fprintf(file, ",%ld", counts.recv[i]);
+	}
+	for ( int b = 0; b < METRIC_SIZE_BUCKETS; b++ ) {
+		fprintf(file, ",%ld", counts.sizes[b]);
+	}
+	fprintf(file, ",%ld,%ld,%ld,%ld,%ld,%ld,%.1f,%ld\n", counts.piggybacks, counts.piggybackEntries, counts.queueMax, counts.queued,
+			nodes, membersMin, nodes ? (double)members / nodes : 0.0, membersMax);
+	fflush(file);
+
+	memset(&counts, 0, sizeof(counts));
+	nodes = membersMin = membersMax = members = 0;
+	lastSnapshot = now;
+}
@@ -0,0 +1,90 @@
+/**********************************
+ * FILE NAME: Metrics.h
+ *
+ * DESCRIPTION: Header file of the counters and gauges written to
+ * 				metrics.csv while the run goes on
+ **********************************/
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+
+/*
+ * Macros
+ */
+#define METRICS_LOG "metrics.csv"
+// message types counted, at least DUMMYLASTMSGTYPE
+#define METRIC_TYPES 16
+// bytes-sent buckets, powers of two up to 2^(METRIC_SIZE_BUCKETS - 1)
+#define METRIC_SIZE_BUCKETS 16
+
+/**
+ * STRUCT NAME: MetricBatch
+ *
+ * DESCRIPTION: Counts of one thread since its batch was last flushed.
+ * 				Message types are those of the first int of a message as
+ * 				it goes on or comes off the network, so a frame counts as
+ * 				one FRAME.
+ */
+typedef struct MetricBatch {
+	long sent[METRIC_TYPES];
+	long sentBytes[METRIC_TYPES];
+	long recv[METRIC_TYPES];
+	// messages sent by size: bucket b holds sizes from 2^(b-1) to 2^b - 1
+	long sizes[METRIC_SIZE_BUCKETS];
+	// messages carrying a piggyback, and the entries in them
+	long piggybacks;
+	long piggybackEntries;
+	// depth of the nodes' queues after receiving: the deepest, and the sum
+	long queueMax;
+	long queued;
+}MetricBatch;
+
+/**
+ * CLASS NAME: Metrics
+ *
+ * DESCRIPTION: Registry of the run's metrics. A worker counts into its
+ * 				own MetricBatch, set with setBatch, and the batches are
+ * 				added up at the tick barrier; other threads count straight
+ * 				into the registry. Every METRICS_INTERVAL ticks snapshot
+ * 				writes a row of metrics.csv with the counts since the last
+ * 				row and the gauges of the nodes at that tick, and starts the
+ * 				counts over. With METRICS_INTERVAL 0 nothing is counted.
+ */
+class Metrics {
+private:
+	Params *par;
+	FILE *file;
+	bool on;
+	int types;
+	MetricBatch counts;
+	// gauges of the nodes, sampled by the caller for the next snapshot
+	long nodes;
+	long membersMin;
+	long membersMax;
+	long members;
+	int lastSnapshot;
+	// batch the calling thread counts into, or NULL to count into counts
+	static thread_local MetricBatch *batch;
+	MetricBatch &current() {
+		return batch ? *batch : counts;
+	}
+public:
+	Metrics(Params *par, int types);
+	Metrics(const Metrics &anotherMetrics) = delete;
+	Metrics& operator = (const Metrics &anotherMetrics) = delete;
+	virtual ~Metrics();
+	void setBatch(MetricBatch *batch);
+	void flushBatch(MetricBatch *batch);
+	void countSent(int type, int bytes);
+	void countRecv(int type);
+	void countPiggyback(int entries);
+	void countQueue(int depth);
+	void sampleMembers(int size);
+	bool due(int now);
+	void snapshot(int now);
+};
+
+#endif /* _METRICS_H_ */
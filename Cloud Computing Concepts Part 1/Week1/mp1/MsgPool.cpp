@@ -0,0 +1,275 @@
+/**********************************
+ * FILE NAME: MsgPool.cpp
+ *
+ * DESCRIPTION: Definition of the message pool
+ **********************************/
+
+#include "MsgPool.h"
+
+thread_local PoolCache *MsgPool::cache = NULL;
+
+/**
+ * Constructor
+ */
+MsgPool::MsgPool(): allocs(0), gets(0) {
+	for ( int i = 0; i < POOL_CLASSES; i++ ) {
+		freeList[i] = NULL;
+	}
+}
+
+/**
+ * Destructor
+ */
+MsgPool::~MsgPool() {
+	for ( unsigned int i = 0; i < slabs.size(); i++ ) {
+		free(slabs[i]);
+	}
+}
+
+/**
+ * FUNCTION NAME: sizeClassOf
+ *
+ * DESCRIPTION: Return the smallest size class whose blocks hold bytes
+ * 				plus the block header, or POOL_OVERSIZE
+ */
+int MsgPool::sizeClassOf(size_t bytes) {
+	size_t blockSize = (size_t)1 << POOL_MIN_SHIFT;
+	bytes += sizeof(PoolBlock);
+
+	for ( int i = 0; i < POOL_CLASSES; i++, blockSize <<= 1 ) {
+		if ( bytes <= blockSize ) {
+			return i;
+		}
+	}
+	return POOL_OVERSIZE;
+}
+
+/**
+ * FUNCTION NAME: grow
+ *
+ * DESCRIPTION: Carve a new slab into POOL_SLAB_BLOCKS free blocks
+ */
+void MsgPool::grow(int sizeClass) {
+	size_t blockSize = (size_t)1 << (POOL_MIN_SHIFT + sizeClass);
+	char *slab = (char *)malloc(blockSize * POOL_SLAB_BLOCKS);
+	PoolBlock *block;
+
+	allocs++;
+	slabs.push_back(slab);
+	for ( int i = POOL_SLAB_BLOCKS - 1; i >= 0; i-- ) {
+		block = (PoolBlock *)(slab + i * blockSize);
+		block->sizeClass = sizeClass;
+		block->next = freeList[sizeClass];
+		freeList[sizeClass] = block;
+	}
+}
+
+/**
+ * FUNCTION NAME: refill
+ *
+ * DESCRIPTION: Move POOL_CACHE_BLOCKS free blocks of a size class into a
+ * 				cache, growing the pool if it runs dry
+ */
+void MsgPool::refill(PoolCache *cache, int sizeClass) {
+	PoolBlock *block;
+	lock_guard<mutex> guard(lock);
+
+	for ( int i = 0; i < POOL_CACHE_BLOCKS; i++ ) {
+		if ( freeList[sizeClass] == NULL ) {
+			grow(sizeClass);
+		}
+		block = freeList[sizeClass];
+		freeList[sizeClass] = block->next;
+		block->next = cache->freeList[sizeClass];
+		cache->freeList[sizeClass] = block;
+	}
+	cache->count[sizeClass] += POOL_CACHE_BLOCKS;
+}
+
+/**
+ * FUNCTION NAME: drain
+ *
+ * DESCRIPTION: Move blocks free blocks of a size class from a cache back
+ * 				to the pool
+ */
+void MsgPool::drain(PoolCache *cache, int sizeClass, int blocks) {
+	PoolBlock *block;
+	lock_guard<mutex> guard(lock);
+
+	for ( int i = 0; i < blocks; i++ ) {
+		block = cache->freeList[sizeClass];
+		cache->freeList[sizeClass] = block->next;
+		block->next = freeList[sizeClass];
+		freeList[sizeClass] = block;
+	}
+	cache->count[sizeClass] -= blocks;
+}
+
+/**
+ * FUNCTION NAME: get
+ *
+ * DESCRIPTION: Return storage for bytes bytes, holding one reference
+ */
+void *MsgPool::get(size_t bytes) {
+	int sizeClass = sizeClassOf(bytes);
+	PoolCache *own = cache && cache->pool == this ? cache : NULL;
+	PoolBlock *block;
+
+	if ( sizeClass == POOL_OVERSIZE ) {
+		lock_guard<mutex> guard(lock);
+		gets++;
+		allocs++;
+		block = (PoolBlock *)malloc(sizeof(PoolBlock) + bytes);
+		block->pool = this;
+		block->sizeClass = POOL_OVERSIZE;
+		block->refs = 1;
+		return block + 1;
+	}
+
+	if ( own ) {
+		if ( own->freeList[sizeClass] == NULL ) {
+			refill(own, sizeClass);
+		}
+		own->gets++;
+		block = own->freeList[sizeClass];
+		own->freeList[sizeClass] = block->next;
+		own->count[sizeClass]--;
+	}
+	else {
+		lock_guard<mutex> guard(lock);
+		gets++;
+		if ( freeList[sizeClass] == NULL ) {
+			grow(sizeClass);
+		}
+		block = freeList[sizeClass];
+		freeList[sizeClass] = block->next;
+	}
+	block->pool = this;
+	block->refs = 1;
+	return block + 1;
+}
+
+/**
+ * FUNCTION NAME: put
+ *
+ * DESCRIPTION: Give storage returned by get back to the pool. A cache
+ * 				holding twice POOL_CACHE_BLOCKS of a class gives half back.
+ */
+void MsgPool::put(void *ptr) {
+	PoolBlock *block = (PoolBlock *)ptr - 1;
+	PoolCache *own = cache && cache->pool == this ? cache : NULL;
+	int sizeClass = block->sizeClass;
+
+	if ( sizeClass == POOL_OVERSIZE ) {
+		free(block);
+		return;
+	}
+	if ( own ) {
+		block->next = own->freeList[sizeClass];
+		own->freeList[sizeClass] = block;
+		if ( ++own->count[sizeClass] >= 2 * POOL_CACHE_BLOCKS ) {
+			drain(own, sizeClass, POOL_CACHE_BLOCKS);
+		}
+		return;
+	}
+	lock_guard<mutex> guard(lock);
+	block->next = freeList[sizeClass];
+	freeList[sizeClass] = block;
+}
+
+/**
+ * FUNCTION NAME: setCache
+ *
+ * DESCRIPTION: Make the calling thread get and put in cache, or lock the
+ * 				pool every time again with NULL
+ */
+void MsgPool::setCache(PoolCache *cache) {
+	if ( cache ) {
+		cache->pool = this;
+	}
+	MsgPool::cache = cache;
+}
+
+/**
+ * FUNCTION NAME: flushCache
+ *
+ * DESCRIPTION: Give all the blocks of a worker's cache back to the pool and
+ * 				count its gets. Only while the worker is not using it, at
+ * 				the tick barrier.
+ */
+void MsgPool::flushCache(PoolCache *cache) {
+	for ( int i = 0; i < POOL_CLASSES; i++ ) {
+		if ( cache->count[i] > 0 ) {
+			drain(cache, i, cache->count[i]);
+		}
+	}
+	lock_guard<mutex> guard(lock);
+	gets += cache->gets;
+	cache->gets = 0;
+}
+
+/**
+ * FUNCTION NAME: retain
+ *
+ * DESCRIPTION: Take another reference on storage returned by get
+ */
+void MsgPool::retain(void *ptr) {
+	((PoolBlock *)ptr - 1)->refs++;
+}
+
+/**
+ * FUNCTION NAME: release
+ *
+ * DESCRIPTION: Drop a reference; the last one gives the storage back to
+ * 				the pool it came from
+ */
+void MsgPool::release(void *ptr) {
+	PoolBlock *block = (PoolBlock *)ptr - 1;
+
+	if ( --block->refs == 0 ) {
+		block->pool->put(ptr);
+	}
+}
+
+/**
+ * Constructor
+ * Adopts the reference held by block
+ */
+MsgView::MsgView(void *block, char *data, int size): block(block), data(data), size(size) {}
+
+/**
+ * Copy constructor
+ */
+MsgView::MsgView(const MsgView &anotherView): block(anotherView.block), data(anotherView.data), size(anotherView.size) {
+	if ( block ) {
+		MsgPool::retain(block);
+	}
+}
+
+/**
+ * Move constructor
+ */
+MsgView::MsgView(MsgView &&anotherView): block(anotherView.block), data(anotherView.data), size(anotherView.size) {
+	anotherView.block = NULL;
+	anotherView.data = NULL;
+	anotherView.size = 0;
+}
+
+/**
+ * Assignment operator overloading
+ */
+MsgView& MsgView::operator =(MsgView anotherView) {
+	swap(block, anotherView.block);
+	swap(data, anotherView.data);
+	swap(size, anotherView.size);
+	return *this;
+}
+
+/**
+ * Destructor
+ */
+MsgView::~MsgView() {
+	if ( block ) {
+		MsgPool::release(block);
+	}
+}
@@ -0,0 +1,134 @@
+/**********************************
+ * FILE NAME: MsgPool.h
+ *
+ * DESCRIPTION: Header file of the message pool used by the emulated network
+ **********************************/
+
+#ifndef _MSGPOOL_H_
+#define _MSGPOOL_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// smallest block is 1 << POOL_MIN_SHIFT bytes
+#define POOL_MIN_SHIFT 6
+// size classes 64, 128, ..., 4096 bytes
+#define POOL_CLASSES 7
+// number of blocks carved out of each slab
+#define POOL_SLAB_BLOCKS 32
+// size class of blocks too big for any slab
+#define POOL_OVERSIZE -1
+// blocks a cache takes from or gives back to the pool at a time
+#define POOL_CACHE_BLOCKS 32
+
+/**
+ * Struct Name: PoolBlock
+ *
+ * DESCRIPTION: Header in front of every block handed out by MsgPool
+ */
+class MsgPool;
+typedef struct PoolBlock {
+	// next free block of the same size class
+	struct PoolBlock *next;
+	// pool the block belongs to
+	MsgPool *pool;
+	// size class, or POOL_OVERSIZE
+	int sizeClass;
+	// number of MsgViews referring to the block
+	int refs;
+}PoolBlock;
+
+/**
+ * STRUCT NAME: PoolCache
+ *
+ * DESCRIPTION: Free blocks kept by one worker so that it can get and put
+ * 				without locking the pool. Set with MsgPool::setCache; zeroed
+ * 				storage is an empty cache.
+ */
+typedef struct PoolCache {
+	// pool the cache was last set on
+	MsgPool *pool;
+	PoolBlock *freeList[POOL_CLASSES];
+	int count[POOL_CLASSES];
+	// number of blocks handed out since the cache was last flushed
+	long gets;
+}PoolCache;
+
+/**
+ * CLASS NAME: MsgPool
+ *
+ * DESCRIPTION: Size-class slab pools for message storage. Freed blocks go
+ * 				back on their class's free list and are reused, so malloc
+ * 				is only called when a class runs dry. get and put may be
+ * 				called from several threads; the reference count of a block
+ * 				is only touched by the thread that currently owns its views.
+ * 				A thread with a PoolCache set gets and puts in it, and only
+ * 				locks the pool to move POOL_CACHE_BLOCKS blocks at a time;
+ * 				flushCache gives the rest back at the tick barrier.
+ */
+class MsgPool {
+private:
+	PoolBlock *freeList[POOL_CLASSES];
+	vector<void *> slabs;
+	// number of malloc calls made
+	long allocs;
+	// number of blocks handed out
+	long gets;
+	// guards the free lists; blocks are got and put from worker threads
+	mutex lock;
+	// cache the calling thread gets and puts in, or NULL to lock every time
+	static thread_local PoolCache *cache;
+	int sizeClassOf(size_t bytes);
+	void grow(int sizeClass);
+	void refill(PoolCache *cache, int sizeClass);
+	void drain(PoolCache *cache, int sizeClass, int blocks);
+public:
+	MsgPool();
+	MsgPool(const MsgPool &anotherPool) = delete;
+	MsgPool& operator = (const MsgPool &anotherPool) = delete;
+	virtual ~MsgPool();
+	void *get(size_t bytes);
+	void put(void *ptr);
+	void setCache(PoolCache *cache);
+	void flushCache(PoolCache *cache);
+	static void retain(void *ptr);
+	static void release(void *ptr);
+	long getAllocs() {
+		return allocs;
+	}
+	long getGets() {
+		return gets;
+	}
+};
+
+/**
+ * CLASS NAME: MsgView
+ *
+ * DESCRIPTION: Reference-counted handle on a message payload stored in a
+ * 				MsgPool block. Copies share the block; it goes back to its
+ * 				pool when the last handle is destroyed.
+ */
+class MsgView {
+private:
+	// storage returned by MsgPool::get
+	void *block;
+	char *data;
+	int size;
+public:
+	MsgView(): block(NULL), data(NULL), size(0) {}
+	MsgView(void *block, char *data, int size);
+	MsgView(const MsgView &anotherView);
+	MsgView(MsgView &&anotherView);
+	MsgView& operator =(MsgView anotherView);
+	virtual ~MsgView();
+	char *getData() {
+		return data;
+	}
+	int getSize() {
+		return size;
+	}
+};
+
+#endif /* _MSGPOOL_H_ */
@@ -5,6 +5,7 @@
  **********************************/
 
 #include "Params.h"
+#include "EventLog.h"
 
 /**
  * Constructor
@@ -18,6 +19,8 @@ Params::Params(): PORTNUM(8001) {}
  */
 void Params::setparams(char *config_file) {
 	FILE *fp = fopen(config_file,"r");
+	char key[64];
+	char line[1024];
 
 	fscanf(fp,"MAX_NNB: %d", &MAX_NNB);
 	fscanf(fp,"\nSINGLE_FAILURE: %d", &SINGLE_FAILURE);
@@ -31,6 +34,49 @@ void Params::setparams(char *config_file) {
 	MAX_MSG_SIZE = 4000;
 	globaltime = 0;
 	dropmsg = 0;
+	SWAP_ORDER = 1;
+	PIGGYBACK_MAX = 8;
+	PIGGYBACK_LAMBDA = 3;
+	THREADS = 1;
+	PROBE_K = 3;
+	SUSPECT_TIMEOUT = 60;
+	SEED = DEFAULT_SEED;
+	RUN_TIME = 700;
+	LATENCY = LATENCY_NEXT_TICK;
+	LATENCY_MEAN = 1;
+	LATENCY_SPREAD = 0;
+	EVENT_LOG = 0;
+	LOG_LEVEL = 0;
+	METRICS_INTERVAL = 0;
+
+	// optional "KEY: value ..." lines after the four fixed ones
+	while ( fscanf(fp, " %63[^:]:", key) == 1 && fgets(line, sizeof(line), fp) != NULL ) {
+		ConfLine conf;
+		char *next = line, *end;
+		conf.key = key;
+		for ( double value = strtod(next, &end); end != next; value = strtod(next, &end) ) {
+			conf.values.push_back(value);
+			next = end;
+		}
+		if ( confList(conf.key) != NULL ) {
+			confList(conf.key)->push_back(conf);
+		}
+		else if ( conf.values.size() == 1 ) {
+			setoption(key, line);
+		}
+	}
+
+	THREADS = max(1, min(THREADS, EN_GPSZ));
+	// a piggyback carries the sender's own entry and at least one change,
+	// and a change or a suspicion lasts at least one send or one tick
+	PIGGYBACK_MAX = max(2, PIGGYBACK_MAX);
+	PIGGYBACK_LAMBDA = max(1, PIGGYBACK_LAMBDA);
+	SUSPECT_TIMEOUT = max(1, SUSPECT_TIMEOUT);
+	// event records keep 16-bit node ids and 24-bit times
+	if ( EN_GPSZ > EVENT_MAX_ID || RUN_TIME > EVENT_MAX_TIME ) {
+		EVENT_LOG = 0;
+	}
+
 	allNodesJoined = 0;
 	for ( unsigned int i = 0; i < EN_GPSZ; i++ ) {
 		allNodesJoined += i;
@@ -39,6 +85,74 @@ void Params::setparams(char *config_file) {
 	return;
 }
 
+/**
+ * FUNCTION NAME: setoption
+ *
+ * DESCRIPTION: Set an optional parameter from the text of its config line.
+ * 				Integer keys are parsed as integers, so a SEED above 2^53
+ * 				keeps every digit. Unknown keys are ignored.
+ */
+void Params::setoption(const char *key, const char *text) {
+	if ( 0 == strcmp(key, "SWAP_ORDER") ) {
+		SWAP_ORDER = (int)strtol(text, NULL, 10);
+	}
+	else if ( 0 == strcmp(key, "PIGGYBACK_MAX") ) {
+		PIGGYBACK_MAX = (int)strtol(text, NULL, 10);
+	}
+	else if ( 0 == strcmp(key, "PIGGYBACK_LAMBDA") ) {
+		PIGGYBACK_LAMBDA = (int)strtol(text, NULL, 10);
+	}
+	else if ( 0 == strcmp(key, "THREADS") ) {
+		THREADS = (int)strtol(text, NULL, 10);
+	}
+	else if ( 0 == strcmp(key, "PROBE_K") ) {
+		PROBE_K = (int)strtol(text, NULL, 10);
+	}
+	else if ( 0 == strcmp(key, "SUSPECT_TIMEOUT") ) {
+		SUSPECT_TIMEOUT = (int)strtol(text, NULL, 10);
+	}
+	else if ( 0 == strcmp(key, "SEED") ) {
+		SEED = strtoull(text, NULL, 10);
+	}
+	else if ( 0 == strcmp(key, "RUN_TIME") ) {
+		RUN_TIME = (int)strtol(text, NULL, 10);
+	}
+	else if ( 0 == strcmp(key, "LATENCY") ) {
+		LATENCY = (int)strtol(text, NULL, 10);
+	}
+	else if ( 0 == strcmp(key, "LATENCY_MEAN") ) {
+		LATENCY_MEAN = strtod(text, NULL);
+	}
+	else if ( 0 == strcmp(key, "LATENCY_SPREAD") ) {
+		LATENCY_SPREAD = strtod(text, NULL);
+	}
+	else if ( 0 == strcmp(key, "EVENT_LOG") ) {
+		EVENT_LOG = (int)strtol(text, NULL, 10);
+	}
+	else if ( 0 == strcmp(key, "LOG_LEVEL") ) {
+		LOG_LEVEL = (int)strtol(text, NULL, 10);
+	}
+	else if ( 0 == strcmp(key, "METRICS_INTERVAL") ) {
+		METRICS_INTERVAL = (int)strtol(text, NULL, 10);
+	}
+}
+
+/**
+ * FUNCTION NAME: confList
+ *
+ * DESCRIPTION: The list that keeps config lines with this key, or NULL for
+ * 				a single-valued option
+ */
+vector<ConfLine> *Params::confList(const string &key) {
+	if ( key == "GROUP" || key == "PARTITION" || key == "LOSS" || key == "BURST" ) {
+		return &linkFaults;
+	}
+	if ( key == "FAIL" || key == "FAIL_RANDOM" || key == "LEAVE" || key == "RESTART" || key == "ROLLING" || key == "CHURN" || key == "DROP" ) {
+		return &scenario;
+	}
+	return NULL;
+}
+
 /**
  * FUNCTION NAME: getcurrtime
  *
@@ -11,8 +11,27 @@
 #include "Params.h"
 #include "Member.h"
 
+/*
+ * Macros
+ */
+// seed of runs whose config does not give one
+#define DEFAULT_SEED 1
+
 enum testTYPE { CREATE_TEST, READ_TEST, UPDATE_TEST, DELETE_TEST };
 
+// how EmulNet draws the latency of a link
+enum latencyTYPE { LATENCY_NEXT_TICK, LATENCY_CONSTANT, LATENCY_UNIFORM, LATENCY_LOGNORMAL };
+
+/**
+ * STRUCT NAME: ConfLine
+ *
+ * DESCRIPTION: An optional config line with several values, "KEY: v1 v2 ..."
+ */
+typedef struct ConfLine {
+	string key;
+	vector<double> values;
+}ConfLine;
+
 /**
  * CLASS NAME: Params
  *
@@ -31,8 +50,49 @@ public:
 	int globaltime;
 	int allNodesJoined;
 	short PORTNUM;
+	int SWAP_ORDER;             // deliver in the legacy swap-with-last buffer order (default), 0 for newest first
+	int PIGGYBACK_MAX;          // max membership entries piggybacked per message, at least 2
+	int PIGGYBACK_LAMBDA;       // a change is piggybacked LAMBDA*log2(n+1) times, at least 1
+	int THREADS;                // worker threads running the nodes each tick
+	int PROBE_K;                // members asked to probe a suspect indirectly
+	int SUSPECT_TIMEOUT;        // ticks a suspect has to refute before it is declared dead, at least 1
+	unsigned long SEED;         // seed of every random generator, DEFAULT_SEED if not given
+	int RUN_TIME;               // ticks to simulate
+	int LATENCY;                // a latencyTYPE; links other than LATENCY_NEXT_TICK deliver from an event queue
+	double LATENCY_MEAN;        // mean link latency in ticks, the median for lognormal
+	double LATENCY_SPREAD;      // half-width of uniform latencies, sigma of the log for lognormal
+	int EVENT_LOG;              // log joins, removals and injected failures to events.bin instead of dbg.log, up to 65535 nodes
+	int LOG_LEVEL;              // lowest traceLEVEL logged, of those compiled in
+	int METRICS_INTERVAL;       // ticks between rows of metrics.csv, 0 for none
+	// link faults, read by LinkModel, in file order. Nodes are given by id.
+	//   GROUP: group first last                       nodes first..last are in group (1..63, default 0)
+	//   PARTITION: start end groupA groupB            no messages between the groups in [start, end);
+	//                                                 groupB -1 cuts groupA off from every other group
+	//   LOSS: start end from to prob                  messages from group from to group to are lost
+	//                                                 with prob; -1 is every group
+	//   BURST: start end from to toBad toGood loss    Gilbert-Elliott loss on the same links: each
+	//                                                 message turns the links bad with toBad, good
+	//                                                 with toGood, and is lost with loss while bad
+	vector<ConfLine> linkFaults;
+	// scenario timeline, read by Scenario, in file order. Any of these lines
+	// replace the failure and drop schedule of SINGLE_FAILURE and DROP_MSG.
+	//   FAIL: time first last [every]                 nodes first..last fail at time, or one every
+	//                                                 every ticks from time
+	//   FAIL_RANDOM: time count                       count consecutive nodes from a random one fail
+	//   LEAVE: time first last [every]                nodes first..last leave the group gracefully,
+	//                                                 or one every every ticks
+	//   RESTART: time first last [every]              failed or departed nodes first..last rejoin
+	//                                                 with a new incarnation, or one every every ticks
+	//   ROLLING: start first last every down          nodes first..last leave one every every ticks
+	//                                                 from start and rejoin down ticks after leaving
+	//   CHURN: start end every down                   a random node fails every every ticks in
+	//                                                 [start, end) and rejoins down ticks later
+	//   DROP: start end prob                          messages are dropped with prob in [start, end)
+	vector<ConfLine> scenario;
 	Params();
 	void setparams(char *);
+	void setoption(const char *key, const char *text);
+	vector<ConfLine> *confList(const string &key);
 	int getcurrtime();
 };
 
@@ -19,9 +19,8 @@ class Queue {
 public:
 	Queue() {}
 	virtual ~Queue() {}
-	static bool enqueue(queue<q_elt> *queue, void *buffer, int size) {
-		q_elt element(buffer, size);
-		queue->emplace(element);
+	static bool enqueue(queue<q_elt> *queue, MsgView msg) {
+		queue->emplace(std::move(msg));
 		return true;
 	}
 };
@@ -0,0 +1,38 @@
+/**********************************
+ * FILE NAME: Random.cpp
+ *
+ * DESCRIPTION: Definition of the pseudo-random generator
+ **********************************/
+
+#include "Random.h"
+
+/**
+ * Constructor
+ */
+Random::Random() {
+	seed(0, 0);
+}
+
+/**
+ * Constructor
+ */
+Random::Random(uint64_t seed, uint64_t stream) {
+	this->seed(seed, stream);
+}
+
+/**
+ * FUNCTION NAME: seed
+ *
+ * DESCRIPTION: Fill the state from seed and stream with splitmix64, which
+ * 				never leaves it all zero and spreads nearby inputs apart
+ */
+void Random::seed(uint64_t seed, uint64_t stream) {
+	uint64_t x = seed ^ (stream * 0xd1342543de82ef95ULL);
+
+	for ( int i = 0; i < 4; i++ ) {
+		uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		s[i] = z ^ (z >> 31);
+	}
+}
@@ -0,0 +1,66 @@
+/**********************************
+ * FILE NAME: Random.h
+ *
+ * DESCRIPTION: Header file of the seedable pseudo-random generator
+ **********************************/
+
+#ifndef _RANDOM_H_
+#define _RANDOM_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// streams of the generators that do not belong to a node; nodes use their id
+#define RNG_STREAM_NET 0xffffffffUL
+#define RNG_STREAM_APP 0xfffffffeUL
+#define RNG_STREAM_LINK 0xfffffffdUL
+#define RNG_STREAM_FAULT 0xfffffffcUL
+#define RNG_STREAM_SCENARIO 0xfffffffbUL
+
+/**
+ * CLASS NAME: Random
+ *
+ * DESCRIPTION: xoshiro256** generator. Every user owns one, seeded from the
+ * 				run seed and its own stream number, so runs with the same
+ * 				seed draw the same numbers whatever thread a node runs on.
+ */
+class Random {
+private:
+	uint64_t s[4];
+	static uint64_t rotl(uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+public:
+	Random();
+	Random(uint64_t seed, uint64_t stream);
+	void seed(uint64_t seed, uint64_t stream);
+	uint64_t next() {
+		uint64_t result = rotl(s[1] * 5, 7) * 9;
+		uint64_t t = s[1] << 17;
+
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+		return result;
+	}
+	// uniform in [0, bound)
+	unsigned int nextInt(unsigned int bound) {
+		return (unsigned int)(((next() >> 32) * bound) >> 32);
+	}
+	// uniform in [0, 1)
+	double nextDouble() {
+		return (next() >> 11) * (1.0 / 9007199254740992.0);
+	}
+	// standard normal, by the Box-Muller transform
+	double nextGaussian() {
+		double u = 1.0 - nextDouble();
+		return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * nextDouble());
+	}
+};
+
+#endif /* _RANDOM_H_ */
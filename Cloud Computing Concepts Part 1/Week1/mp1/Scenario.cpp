@@ -0,0 +1,113 @@
+/**********************************
+ * FILE NAME: Scenario.cpp
+ *
+ * DESCRIPTION: Definition of the scenario timeline
+ **********************************/
+
+#include "Scenario.h"
+
+/**
+ * FUNCTION NAME: init
+ *
+ * DESCRIPTION: Expand the scenario lines of the config into events and sort
+ * 				them. Node ids are clamped to the group; lines with too few
+ * 				values, or a ROLLING or CHURN line without a positive period,
+ * 				are ignored.
+ */
+void Scenario::init(Params *par) {
+	int n = par->EN_GPSZ;
+
+	rng.seed(par->SEED, RNG_STREAM_SCENARIO);
+	events.clear();
+	next = 0;
+
+	if ( par->scenario.empty() ) {
+		if ( par->DROP_MSG ) {
+			add(DROP_START_TIME, SCENARIO_DROP_START, 0, par->MSG_DROP_PROB);
+			add(DROP_END_TIME, SCENARIO_DROP_END, 0);
+		}
+		add(FAIL_TIME, SCENARIO_FAIL_RANDOM, par->SINGLE_FAILURE ? 1 : n / 2);
+	}
+
+	for ( unsigned int i = 0; i < par->scenario.size(); i++ ) {
+		const string &key = par->scenario[i].key;
+		const vector<double> &v = par->scenario[i].values;
+
+		if ( key == "FAIL" && v.size() >= 3 ) {
+			addRange((long)v[0], SCENARIO_FAIL, max(1, (int)v[1]), min(n, (int)v[2]), v.size() > 3 ? (long)v[3] : 0);
+		}
+		else if ( key == "LEAVE" && v.size() >= 3 ) {
+			addRange((long)v[0], SCENARIO_LEAVE, max(1, (int)v[1]), min(n, (int)v[2]), v.size() > 3 ? (long)v[3] : 0);
+		}
+		else if ( key == "RESTART" && v.size() >= 3 ) {
+			addRange((long)v[0], SCENARIO_RESTART, max(1, (int)v[1]), min(n, (int)v[2]), v.size() > 3 ? (long)v[3] : 0);
+		}
+		else if ( key == "FAIL_RANDOM" && v.size() >= 2 ) {
+			add((long)v[0], SCENARIO_FAIL_RANDOM, max(0, min(n, (int)v[1])));
+		}
+		else if ( key == "ROLLING" && v.size() >= 5 && v[3] > 0 ) {
+			addRange((long)v[0], SCENARIO_LEAVE, max(1, (int)v[1]), min(n, (int)v[2]), (long)v[3]);
+			addRange((long)v[0] + (long)v[4], SCENARIO_RESTART, max(1, (int)v[1]), min(n, (int)v[2]), (long)v[3]);
+		}
+		else if ( key == "CHURN" && v.size() >= 4 && v[2] > 0 ) {
+			addChurn((long)v[0], (long)v[1], (long)v[2], (long)v[3], n);
+		}
+		else if ( key == "DROP" && v.size() >= 3 ) {
+			add((long)v[0], SCENARIO_DROP_START, 0, v[2]);
+			add((long)v[1], SCENARIO_DROP_END, 0);
+		}
+	}
+
+	sort(events.begin(), events.end(), [](const ScenarioEvent &a, const ScenarioEvent &b) {
+		return a.time < b.time || (a.time == b.time && a.seq < b.seq);
+	});
+}
+
+/**
+ * FUNCTION NAME: add
+ *
+ * DESCRIPTION: Append one event, after those already added for its tick
+ */
+void Scenario::add(long time, int action, int node, double prob) {
+	ScenarioEvent event = { time, (int)events.size(), action, node, prob };
+	events.push_back(event);
+}
+
+/**
+ * FUNCTION NAME: addRange
+ *
+ * DESCRIPTION: Apply action to nodes first..last at time, or to one node
+ * 				every every ticks from time if every is positive
+ */
+void Scenario::addRange(long time, int action, int first, int last, long every) {
+	for ( int id = first; id <= last; id++ ) {
+		add(time + max(every, (long)0) * (id - first), action, id);
+	}
+}
+
+/**
+ * FUNCTION NAME: addChurn
+ *
+ * DESCRIPTION: Every every ticks in [start, end) fail a random node and
+ * 				restart it down ticks later. A node this line still has
+ * 				down is passed over for the next one up; if all are down
+ * 				that round is skipped.
+ */
+void Scenario::addChurn(long start, long end, long every, long down, int nodes) {
+	vector<long> upAt(nodes + 1, 0);
+
+	for ( long t = start; t < end && nodes > 0; t += every ) {
+		int id = 1 + rng.nextInt(nodes);
+		int tries = 0;
+		while ( upAt[id] > t && tries < nodes ) {
+			id = id % nodes + 1;
+			tries++;
+		}
+		if ( tries == nodes ) {
+			continue;
+		}
+		add(t, SCENARIO_FAIL, id);
+		add(t + down, SCENARIO_RESTART, id);
+		upAt[id] = t + down;
+	}
+}
@@ -0,0 +1,78 @@
+/**********************************
+ * FILE NAME: Scenario.h
+ *
+ * DESCRIPTION: Header file of the timeline of failures, restarts and drop
+ * 				windows a run goes through
+ **********************************/
+
+#ifndef _SCENARIO_H_
+#define _SCENARIO_H_
+
+#include "stdincludes.h"
+#include "Params.h"
+#include "Random.h"
+
+/*
+ * Macros
+ */
+// ticks of the schedule used when the config has no scenario lines
+#define DROP_START_TIME 50
+#define FAIL_TIME 100
+#define DROP_END_TIME 300
+
+// what a scenario event does
+enum scenarioACTION { SCENARIO_FAIL, SCENARIO_FAIL_RANDOM, SCENARIO_LEAVE, SCENARIO_RESTART, SCENARIO_DROP_START, SCENARIO_DROP_END };
+
+/**
+ * STRUCT NAME: ScenarioEvent
+ *
+ * DESCRIPTION: One action at tick time. seq keeps events of the same tick
+ * 				in the order the config gives them.
+ */
+typedef struct ScenarioEvent {
+	long time;
+	int seq;
+	int action;
+	// node id, or the number of nodes for SCENARIO_FAIL_RANDOM
+	int node;
+	// drop probability of SCENARIO_DROP_START
+	double prob;
+}ScenarioEvent;
+
+/**
+ * CLASS NAME: Scenario
+ *
+ * DESCRIPTION: The scenario lines of the config expanded once into events
+ * 				sorted by time. The run takes them off the front as their
+ * 				tick comes, so a tick with nothing scheduled costs one
+ * 				comparison. Without scenario lines the events reproduce the
+ * 				fixed schedule of SINGLE_FAILURE and DROP_MSG.
+ *
+ * 				CHURN draws its nodes here, from its own stream, so the
+ * 				timeline is known before the run starts.
+ */
+class Scenario {
+private:
+	vector<ScenarioEvent> events;
+	unsigned int next;
+	Random rng;
+	void add(long time, int action, int node, double prob = 0);
+	void addRange(long time, int action, int first, int last, long every);
+	void addChurn(long start, long end, long every, long down, int nodes);
+public:
+	Scenario(): next(0) {}
+	void init(Params *par);
+	// whether an event is due by tick now
+	bool due(long now) {
+		return next < events.size() && events[next].time <= now;
+	}
+	ScenarioEvent pop() {
+		return events[next++];
+	}
+	// tick of the next event, or -1
+	long nextTime() {
+		return next < events.size() ? events[next].time : -1;
+	}
+};
+
+#endif /* _SCENARIO_H_ */
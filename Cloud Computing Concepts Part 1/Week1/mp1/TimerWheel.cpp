@@ -0,0 +1,123 @@
+/**********************************
+ * FILE NAME: TimerWheel.cpp
+ *
+ * DESCRIPTION: Definition of the hierarchical timing wheel
+ **********************************/
+
+#include "TimerWheel.h"
+
+/**
+ * FUNCTION NAME: place
+ *
+ * DESCRIPTION: Put timer in the lowest level whose current block holds its
+ * 				due tick, relative to tick now. A timer due at now goes in
+ * 				level 0 and fires when now is expired.
+ */
+void TimerWheel::place(WheelTimer timer, long now) {
+	int level = 0;
+
+	while ( level < WHEEL_LEVELS && ((timer.due ^ now) >> (WHEEL_BITS * (level + 1))) != 0 ) {
+		level++;
+	}
+	if ( level == WHEEL_LEVELS ) {
+		overflow.push_back(timer);
+		return;
+	}
+	slots[level][(timer.due >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)].push_back(timer);
+}
+
+/**
+ * FUNCTION NAME: schedule
+ *
+ * DESCRIPTION: Wake key at tick due, or at the next tick expired if due has
+ * 				passed. Does nothing if key already wakes no later than due.
+ */
+void TimerWheel::schedule(int key, long due) {
+	WheelTimer timer = { key, max(due, current + 1) };
+
+	if ( key >= (int)pending.size() ) {
+		pending.resize(key + 1, -1);
+	}
+	if ( pending[key] >= 0 && pending[key] <= timer.due ) {
+		return;
+	}
+	pending[key] = timer.due;
+	// before the first tick, place as if tick 0 had been expired
+	place(timer, max(current, (long)0));
+}
+
+/**
+ * FUNCTION NAME: nextDue
+ *
+ * DESCRIPTION: The first tick after the last one expired that may have a
+ * 				timer due, or -1 if nothing is scheduled. It is exact for
+ * 				the current 64-tick block; beyond that it is the start of
+ * 				the first block holding a timer, which expiring moves down
+ * 				a level. Timers overtaken by an earlier wake-up can make it
+ * 				early, never late.
+ */
+long TimerWheel::nextDue() {
+	long from = current + 1;
+
+	for ( int level = 0; level < WHEEL_LEVELS; level++ ) {
+		int shift = WHEEL_BITS * level;
+		long block = from >> shift;
+		// the block of from itself was moved down already unless it starts at from
+		long first = level > 0 && (from & (((long)1 << shift) - 1)) != 0 ? block + 1 : block;
+		long last = ((block >> WHEEL_BITS) + 1) << WHEEL_BITS;
+
+		for ( long b = first; b < last; b++ ) {
+			if ( !slots[level][b & (WHEEL_SLOTS - 1)].empty() ) {
+				return max(from, b << shift);
+			}
+		}
+	}
+	if ( !overflow.empty() ) {
+		return ((from >> (WHEEL_BITS * WHEEL_LEVELS)) + 1) << (WHEEL_BITS * WHEEL_LEVELS);
+	}
+	return -1;
+}
+
+/**
+ * FUNCTION NAME: expire
+ *
+ * DESCRIPTION: Advance to tick now, one tick at a time, and append the keys
+ * 				due at now to keys. Keys due at ticks skipped over are
+ * 				appended too.
+ */
+void TimerWheel::expire(long now, vector<int> &keys) {
+	vector<WheelTimer> due;
+
+	while ( current < now ) {
+		current++;
+
+		// move the slots whose block starts now down a level, top first
+		if ( (current & (((long)1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1)) == 0 ) {
+			due.swap(overflow);
+			for ( unsigned int i = 0; i < due.size(); i++ ) {
+				place(due[i], current);
+			}
+			due.clear();
+		}
+		for ( int level = WHEEL_LEVELS - 1; level > 0; level-- ) {
+			if ( (current & (((long)1 << (WHEEL_BITS * level)) - 1)) != 0 ) {
+				continue;
+			}
+			due.swap(slots[level][(current >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)]);
+			for ( unsigned int i = 0; i < due.size(); i++ ) {
+				place(due[i], current);
+			}
+			due.clear();
+		}
+
+		due.swap(slots[0][current & (WHEEL_SLOTS - 1)]);
+		for ( unsigned int i = 0; i < due.size(); i++ ) {
+			// skip timers overtaken by an earlier wake-up of the same key
+			if ( pending[due[i].key] == due[i].due ) {
+				pending[due[i].key] = -1;
+				keys.push_back(due[i].key);
+			}
+		}
+		due.clear();
+	}
+}
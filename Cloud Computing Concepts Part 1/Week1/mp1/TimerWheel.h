@@ -0,0 +1,67 @@
+/**********************************
+ * FILE NAME: TimerWheel.h
+ *
+ * DESCRIPTION: Header file of the hierarchical timing wheel that decides
+ * 				which nodes run in a tick
+ **********************************/
+
+#ifndef _TIMERWHEEL_H_
+#define _TIMERWHEEL_H_
+
+#include "stdincludes.h"
+
+/*
+ * Macros
+ */
+// each level has 1 << WHEEL_BITS slots
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+// levels cover 64, 4096, 262144 and 16777216 ticks
+#define WHEEL_LEVELS 4
+
+/**
+ * STRUCT NAME: WheelTimer
+ *
+ * DESCRIPTION: A wake-up of key at tick due
+ */
+typedef struct WheelTimer {
+	int key;
+	long due;
+}WheelTimer;
+
+/**
+ * CLASS NAME: TimerWheel
+ *
+ * DESCRIPTION: Hierarchical timing wheel of wake-ups keyed by small
+ * 				integers. Level L slot s holds the timers due in the s-th
+ * 				64^L-tick block of the current 64^(L+1)-tick block; a slot
+ * 				is moved down a level when time reaches its block, and
+ * 				level 0 slots fire. Scheduling and expiring cost O(1) per
+ * 				timer, so a tick with nothing due costs next to nothing.
+ *
+ * 				Only the earliest pending wake-up of a key is kept: a key
+ * 				that fires is expected to be scheduled again for whatever
+ * 				it needs next, so later ones would be redundant. Timers
+ * 				overtaken by an earlier one are skipped when they come up.
+ */
+class TimerWheel {
+private:
+	vector<WheelTimer> slots[WHEEL_LEVELS][WHEEL_SLOTS];
+	// timers beyond the top level, looked at again when it wraps
+	vector<WheelTimer> overflow;
+	// earliest wake-up scheduled for each key, or -1
+	vector<long> pending;
+	// last tick expired
+	long current;
+	void place(WheelTimer timer, long now);
+public:
+	TimerWheel(): current(-1) {}
+	void schedule(int key, long due);
+	void expire(long now, vector<int> &keys);
+	long nextDue();
+	long getPending(int key) {
+		return key < (int)pending.size() ? pending[key] : -1;
+	}
+};
+
+#endif /* _TIMERWHEEL_H_ */
@@ -0,0 +1,51 @@
+/**********************************
+ * FILE NAME: Trace.h
+ *
+ * DESCRIPTION: Level-filtered debug tracing into the Log
+ **********************************/
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include "stdincludes.h"
+
+// trace levels, from the most verbose
+enum traceLEVEL { TRACE_DEBUG, TRACE_INFO, TRACE_WARN, TRACE_ERROR, TRACE_OFF };
+
+/*
+ * Macros
+ */
+// lowest level compiled in, e.g. -DTRACE_LEVEL=TRACE_INFO. Without
+// DEBUGLOG no trace is compiled in.
+#ifndef TRACE_LEVEL
+#ifdef DEBUGLOG
+#define TRACE_LEVEL TRACE_DEBUG
+#else
+#define TRACE_LEVEL TRACE_OFF
+#endif
+#endif
+
+/**
+ * STRUCT NAME: TraceLevel
+ *
+ * DESCRIPTION: Whether traces of a level are compiled in
+ */
+template <int level>
+struct TraceLevel {
+	static const bool compiled = level >= TRACE_LEVEL;
+};
+
+/*
+ * TRACE(level, log, addr, format, ...) logs a line for addr when level is
+ * compiled in and the log accepts it. Its arguments are evaluated, and the
+ * line formatted, only then: a trace below TRACE_LEVEL is removed by the
+ * compiler, and one below the LOG_LEVEL of the run costs a comparison.
+ */
+#define TRACE(level, log, addr, ...) \
+	do { \
+		if ( TraceLevel<level>::compiled && (log)->accepts(level) ) { \
+			(log)->LOG((addr), __VA_ARGS__); \
+		} \
+	} while (0)
+
+#endif /* _TRACE_H_ */
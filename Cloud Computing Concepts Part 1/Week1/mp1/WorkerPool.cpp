@@ -0,0 +1,80 @@
+/**********************************
+ * FILE NAME: WorkerPool.cpp
+ *
+ * DESCRIPTION: Definition of the worker pool
+ **********************************/
+
+#include "WorkerPool.h"
+
+/**
+ * Constructor
+ */
+WorkerPool::WorkerPool(int workers): round(0), pending(0), stopping(false) {
+	for ( int i = 1; i < workers; i++ ) {
+		threads.push_back(thread(&WorkerPool::work, this, i));
+	}
+}
+
+/**
+ * Destructor
+ */
+WorkerPool::~WorkerPool() {
+	{
+		lock_guard<mutex> guard(lock);
+		stopping = true;
+	}
+	start.notify_all();
+	for ( unsigned int i = 0; i < threads.size(); i++ ) {
+		threads[i].join();
+	}
+}
+
+/**
+ * FUNCTION NAME: run
+ *
+ * DESCRIPTION: Run task(w) on every worker w and return once all are done
+ */
+void WorkerPool::run(function<void(int)> task) {
+	{
+		lock_guard<mutex> guard(lock);
+		this->task = task;
+		pending = threads.size();
+		round++;
+	}
+	start.notify_all();
+
+	task(0);
+
+	unique_lock<mutex> guard(lock);
+	done.wait(guard, [this] { return pending == 0; });
+}
+
+/**
+ * FUNCTION NAME: work
+ *
+ * DESCRIPTION: Body of each pool thread: wait for a round, run it, report
+ */
+void WorkerPool::work(int worker) {
+	long seen = 0;
+
+	while ( true ) {
+		function<void(int)> current;
+		{
+			unique_lock<mutex> guard(lock);
+			start.wait(guard, [this, seen] { return stopping || round != seen; });
+			if ( stopping ) {
+				return;
+			}
+			seen = round;
+			current = task;
+		}
+
+		current(worker);
+
+		{
+			lock_guard<mutex> guard(lock);
+			pending--;
+		}
+		done.notify_one();
+	}
+}
@@ -0,0 +1,44 @@
+/**********************************
+ * FILE NAME: WorkerPool.h
+ *
+ * DESCRIPTION: Header file of the worker pool that runs a tick in parallel
+ **********************************/
+
+#ifndef _WORKERPOOL_H_
+#define _WORKERPOOL_H_
+
+#include "stdincludes.h"
+
+/**
+ * CLASS NAME: WorkerPool
+ *
+ * DESCRIPTION: A fixed set of threads that run one task per worker and
+ * 				meet at a barrier. Worker 0 is the thread calling run, so a
+ * 				pool of one starts no threads.
+ */
+class WorkerPool {
+private:
+	vector<thread> threads;
+	mutex lock;
+	// signalled when a new round starts and when a worker finishes one
+	condition_variable start;
+	condition_variable done;
+	function<void(int)> task;
+	// number of rounds started so far
+	long round;
+	// workers still running the current round
+	int pending;
+	bool stopping;
+	void work(int worker);
+public:
+	WorkerPool(int workers);
+	WorkerPool(const WorkerPool &anotherPool) = delete;
+	WorkerPool& operator = (const WorkerPool &anotherPool) = delete;
+	virtual ~WorkerPool();
+	void run(function<void(int)> task);
+	int size() {
+		return threads.size() + 1;
+	}
+};
+
+#endif /* _WORKERPOOL_H_ */
@@ -21,6 +21,7 @@
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <assert.h>
 #include <time.h>
 #include <stdarg.h>
@@ -35,6 +36,11 @@
 #include <algorithm>
 #include <queue>
 #include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
 
 using namespace std;
 